@@ -0,0 +1,71 @@
+#!/usr/bin/python3
+
+# idle-rss.py - Measures the resident memory of the proxy while it holds
+#               many idle client connections (one thread per connection).
+#               Each client sends a partial request line and then waits,
+#               so every proxy thread is parked inside doit().
+#
+# usage: idle-rss.py <proxy-binary> <port> [count ...]
+#        (default counts: 1000 5000 10000)
+#
+import os
+import resource
+import socket
+import subprocess
+import sys
+import time
+
+
+def status(pid):
+  fields = {}
+  with open("/proc/%d/status" % pid) as f:
+    for line in f:
+      key, _, val = line.partition(":")
+      fields[key] = val.strip()
+  return fields
+
+
+def wait_threads(pid, want, timeout=60):
+  deadline = time.time() + timeout
+  while time.time() < deadline:
+    if int(status(pid)["Threads"]) >= want:
+      return True
+    time.sleep(0.1)
+  return False
+
+
+if len(sys.argv) < 3:
+  print("usage: %s <proxy-binary> <port> [count ...]" % sys.argv[0])
+  sys.exit(1)
+
+binary, port = sys.argv[1], int(sys.argv[2])
+counts = [int(x) for x in sys.argv[3:]] or [1000, 5000, 10000]
+
+soft, hard = resource.getrlimit(resource.RLIMIT_NOFILE)
+need = max(counts) + 64
+if soft < need:
+  resource.setrlimit(resource.RLIMIT_NOFILE, (min(need, hard), hard))
+
+devnull = open(os.devnull, "w")
+proxy = subprocess.Popen([binary, str(port)], stdout=devnull, stderr=devnull)
+time.sleep(0.5)
+
+socks = []
+print("%8s %12s %12s %10s" % ("conns", "VmRSS", "VmSize", "threads"))
+try:
+  for count in sorted(counts):
+    while len(socks) < count:
+      s = socket.create_connection(("localhost", port))
+      s.sendall(b"GET http://localhost/")
+      socks.append(s)
+    if not wait_threads(proxy.pid, count + 1):
+      print("proxy did not reach %d threads" % count)
+      break
+    time.sleep(0.5)
+    st = status(proxy.pid)
+    print("%8d %12s %12s %10s" % (count, st["VmRSS"], st["VmSize"], st["Threads"]))
+finally:
+  for s in socks:
+    s.close()
+  proxy.kill()
+  proxy.wait()
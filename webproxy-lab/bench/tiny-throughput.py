@@ -0,0 +1,98 @@
+#!/usr/bin/python3
+
+# tiny-throughput.py - Compares tiny's iterative mode with its prethreaded
+#                      mode (-t N). For each mode, CLIENTS client threads
+#                      fetch <path> in a loop for DURATION seconds, one
+#                      connection per request. The run is repeated with
+#                      SLOW extra clients that send half a request line and
+#                      then stall, which is what blocks an iterative server.
+#
+# usage: tiny-throughput.py <tiny-dir> <port> [path] [nthreads ...]
+#        (default path: /home.html, default nthreads: 4 16)
+#
+import os
+import socket
+import subprocess
+import sys
+import threading
+import time
+
+CLIENTS = 8
+DURATION = 3.0
+SLOW = 4
+TIMEOUT = 1.0
+
+
+def fetch(port, request):
+  s = socket.create_connection(("127.0.0.1", port), timeout=TIMEOUT)
+  try:
+    s.sendall(request)
+    n = 0
+    while True:
+      data = s.recv(65536)
+      if not data:
+        return n
+      n += len(data)
+  finally:
+    s.close()
+
+
+def client(port, request, deadline, counts, i):
+  while time.time() < deadline:
+    try:
+      if fetch(port, request) > 0:
+        counts[i] += 1
+    except OSError:
+      pass
+
+
+def run(tiny_dir, port, path, args, slow):
+  devnull = open(os.devnull, "w")
+  tiny = subprocess.Popen(["./tiny"] + args + [str(port)], cwd=tiny_dir,
+                          stdout=devnull, stderr=devnull)
+  try:
+    for _ in range(50):
+      try:
+        socket.create_connection(("127.0.0.1", port), timeout=TIMEOUT).close()
+        break
+      except OSError:
+        time.sleep(0.1)
+
+    stalled = []
+    for _ in range(slow):
+      s = socket.create_connection(("127.0.0.1", port))
+      s.sendall(b"GET " + path.encode())
+      stalled.append(s)
+
+    request = ("GET %s HTTP/1.0\r\nHost: localhost\r\n\r\n" % path).encode()
+    counts = [0] * CLIENTS
+    deadline = time.time() + DURATION
+    threads = [threading.Thread(target=client,
+                                args=(port, request, deadline, counts, i))
+               for i in range(CLIENTS)]
+    for t in threads:
+      t.start()
+    for t in threads:
+      t.join()
+    for s in stalled:
+      s.close()
+    return sum(counts) / DURATION
+  finally:
+    tiny.kill()
+    tiny.wait()
+
+
+if len(sys.argv) < 3:
+  print("usage: %s <tiny-dir> <port> [path] [nthreads ...]" % sys.argv[0])
+  sys.exit(1)
+
+tiny_dir, port = sys.argv[1], int(sys.argv[2])
+path = sys.argv[3] if len(sys.argv) > 3 else "/home.html"
+nthreads = [int(x) for x in sys.argv[4:]] or [4, 16]
+
+modes = [("iterative", [])] + [("-t %d" % n, ["-t", str(n)]) for n in nthreads]
+print("%-12s %14s %20s" % ("mode", "req/s", "req/s (%d stalled)" % SLOW))
+for name, args in modes:
+  fast = run(tiny_dir, port, path, args, 0)
+  slow = run(tiny_dir, port, path, args, SLOW)
+  print("%-12s %14.0f %20.0f" % (name, fast, slow))
@@ -0,0 +1,715 @@
+/*
+ * cache.c — 프록시 메모리 캐시 구현
+ *
+ * ✅ 락 순서: cache_lock(rwlock) → lru_lock(mutex)
+ *   - 조회(read lock) 중에도 LRU 갱신은 lru_lock만 잡고 짧게 끝낸다.
+ *   - 삽입/퇴출(write lock)은 리스트 구조를 바꾸므로 lru_lock도 같이 잡는다.
+ *   - 만료 힙은 write lock 아래에서만 바뀐다(삽입/퇴출/재검증 모두 write lock).
+ */
+#include "cache.h"
+#include "stats.h"
+#include "disk.h"
+#include "shm.h"
+#include "neg.h"
+
+static cache_entry_t *buckets[CACHE_BUCKETS];
+static cache_entry_t *lru_head, *lru_tail; /* head = 가장 최근 사용 */
+static size_t cache_bytes;                 /* 현재 저장된 객체 바이트 합 */
+
+/* 만료 인덱스: evict_at 기준 min-heap */
+static cache_entry_t **heap;
+static int heap_len, heap_cap;
+
+static pthread_rwlock_t cache_lock = PTHREAD_RWLOCK_INITIALIZER;
+static pthread_mutex_t lru_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* 변형 키 구분자 — URL에는 나오지 않는 제어 문자 */
+#define VARY_SEP '\x1f'
+
+/* djb2 — URL 부분만 해시해서 같은 URL의 변형이 한 체인에 모이게 한다 */
+static unsigned hash_key(const char *key)
+{
+  unsigned h = 5381;
+
+  while (*key && *key != VARY_SEP)
+    h = h * 33 + (unsigned char)*key++;
+  return h % CACHE_BUCKETS;
+}
+
+static void lru_unlink(cache_entry_t *e)
+{
+  if (e->prev)
+    e->prev->next = e->next;
+  else
+    lru_head = e->next;
+  if (e->next)
+    e->next->prev = e->prev;
+  else
+    lru_tail = e->prev;
+  e->prev = e->next = NULL;
+}
+
+static void lru_push_front(cache_entry_t *e)
+{
+  e->prev = NULL;
+  e->next = lru_head;
+  if (lru_head)
+    lru_head->prev = e;
+  lru_head = e;
+  if (!lru_tail)
+    lru_tail = e;
+}
+
+/* ---- 만료 힙 ---- */
+
+static void heap_set(int i, cache_entry_t *e)
+{
+  heap[i] = e;
+  e->heap_idx = i;
+}
+
+static void heap_up(int i)
+{
+  cache_entry_t *e = heap[i];
+
+  while (i > 0 && heap[(i - 1) / 2]->evict_at > e->evict_at)
+  {
+    heap_set(i, heap[(i - 1) / 2]);
+    i = (i - 1) / 2;
+  }
+  heap_set(i, e);
+}
+
+static void heap_down(int i)
+{
+  cache_entry_t *e = heap[i];
+
+  while (2 * i + 1 < heap_len)
+  {
+    int child = 2 * i + 1;
+    if (child + 1 < heap_len && heap[child + 1]->evict_at < heap[child]->evict_at)
+      child++;
+    if (heap[child]->evict_at >= e->evict_at)
+      break;
+    heap_set(i, heap[child]);
+    i = child;
+  }
+  heap_set(i, e);
+}
+
+static void heap_push(cache_entry_t *e)
+{
+  if (heap_len == heap_cap)
+  {
+    heap_cap = heap_cap ? heap_cap * 2 : 64;
+    heap = Realloc(heap, heap_cap * sizeof(*heap));
+  }
+  heap_set(heap_len++, e);
+  heap_up(e->heap_idx);
+}
+
+static void heap_remove(cache_entry_t *e)
+{
+  int i = e->heap_idx;
+  cache_entry_t *last = heap[--heap_len];
+
+  e->heap_idx = -1;
+  if (i == heap_len)
+    return;
+  heap_set(i, last);
+  heap_up(i);
+  heap_down(last->heap_idx);
+}
+
+/* evict_at이 바뀐 엔트리의 힙 위치 재조정 */
+static void heap_fix(cache_entry_t *e)
+{
+  heap_up(e->heap_idx);
+  heap_down(e->heap_idx);
+}
+
+/*
+ * cache_evict_time(m)
+ *  - 이 시각이 지나면 엔트리는 어떤 용도로도 쓸 수 없다.
+ *  - 신선도 만료 + max(SWR, SIE). 검증자가 있으면 304 재검증용으로 조금 더 둔다.
+ */
+time_t cache_evict_time(const cache_meta_t *m)
+{
+  time_t t = m->response_time + (m->lifetime - m->initial_age);
+  long window = m->swr > m->sie ? m->swr : m->sie;
+
+  if (!m->must_revalidate)
+    t += window;
+  if (m->etag[0] || m->last_modified[0])
+    t += CACHE_REVALIDATE_GRACE;
+  return t;
+}
+
+static void entry_free(cache_entry_t *e)
+{
+  free(e->key);
+  if (e->release)
+    e->release(e->data, e->size);
+  else
+    free(e->data);
+  free(e);
+}
+
+static void entry_put(cache_entry_t *e)
+{
+  if (__atomic_sub_fetch(&e->refcnt, 1, __ATOMIC_ACQ_REL) == 0)
+    entry_free(e);
+}
+
+/* write lock 보유 상태에서 호출 — 해시/LRU에서 떼고 인덱스 참조를 놓는다 */
+static void unlink_locked(cache_entry_t *e)
+{
+  cache_entry_t **pp = &buckets[hash_key(e->key)];
+
+  while (*pp && *pp != e)
+    pp = &(*pp)->hnext;
+  if (*pp)
+    *pp = e->hnext;
+
+  pthread_mutex_lock(&lru_lock);
+  lru_unlink(e);
+  pthread_mutex_unlock(&lru_lock);
+  heap_remove(e);
+
+  cache_bytes -= e->size;
+  entry_put(e);
+}
+
+static cache_entry_t *find_locked(const char *key)
+{
+  cache_entry_t *e;
+
+  for (e = buckets[hash_key(key)]; e; e = e->hnext)
+    if (!strcmp(e->key, key))
+      return e;
+  return NULL;
+}
+
+/* e가 url의 엔트리(변형 포함)인지 */
+static int same_url(const cache_entry_t *e, const char *url, size_t ulen)
+{
+  return !strncmp(e->key, url, ulen) && (e->key[ulen] == '\0' || e->key[ulen] == VARY_SEP);
+}
+
+/* vary 목록의 이름마다 "\x1f이름=값"을 out에 덧붙인다(요청에 없는 헤더는 빈 값) */
+static void append_variant(dbuf_t *out, const char *vary, const char *req_hdrs)
+{
+  char name[HTTP_VARY_LEN];
+
+  while (*vary)
+  {
+    size_t n = strcspn(vary, ","), vlen = 0;
+    const char *v;
+
+    memcpy(name, vary, n);
+    name[n] = '\0';
+    v = req_hdrs ? http_find_header(req_hdrs, name, &vlen) : NULL;
+    dbuf_printf(out, "%c%s=", VARY_SEP, name);
+    if (v)
+      dbuf_append(out, v, vlen);
+    vary += n;
+    if (*vary == ',')
+      vary++;
+  }
+}
+
+/*
+ * cache_variant_key(out, key, vary, req_hdrs)
+ *  - 저장 키를 out에 만든다: Vary가 없으면 key(URL) 그대로, 있으면 URL 뒤에
+ *    요청 헤더(req_hdrs)에서 뽑은 2차 키를 붙인다.
+ */
+void cache_variant_key(dbuf_t *out, const char *key, const char *vary, const char *req_hdrs)
+{
+  dbuf_set(out, key, strlen(key));
+  append_variant(out, vary, req_hdrs);
+}
+
+/*
+ * match_locked(url, req_hdrs, sec)
+ *  - url의 엔트리 중 이 요청에 맞는 변형을 찾는다.
+ *  - req_hdrs가 NULL이면(요청 헤더를 아직 안 읽음) Vary 없는 엔트리만 맞는다.
+ *  - 한 URL의 변형은 Vary 목록이 같으므로 2차 키는 한 번만 계산한다(sec).
+ */
+static cache_entry_t *match_locked(const char *url, const char *req_hdrs, dbuf_t *sec)
+{
+  size_t ulen = strlen(url);
+  const char *built = NULL;
+  cache_entry_t *e;
+
+  for (e = buckets[hash_key(url)]; e; e = e->hnext)
+  {
+    if (!same_url(e, url, ulen))
+      continue;
+    if (!e->meta.vary[0])
+    {
+      if (e->key[ulen] == '\0')
+        return e;
+      continue;
+    }
+    if (!req_hdrs)
+      continue;
+    if (!built || strcmp(built, e->meta.vary))
+    {
+      dbuf_reset(sec);
+      append_variant(sec, e->meta.vary, req_hdrs);
+      built = e->meta.vary;
+    }
+    if (!strcmp(e->key + ulen, sec->data))
+      return e;
+  }
+  return NULL;
+}
+
+void cache_init(void)
+{
+  memset(buckets, 0, sizeof(buckets));
+  lru_head = lru_tail = NULL;
+  cache_bytes = 0;
+  heap_len = 0;
+}
+
+/*
+ * cache_lookup(key, req_hdrs, meta)
+ *  - key(URL)와 요청 헤더(req_hdrs, "Name: value\r\n" 블록)에 맞는 변형을 찾는다.
+ *    req_hdrs가 NULL이면 Vary 없는 응답만 찾는다.
+ *  - 히트면 참조를 하나 올린 엔트리를 돌려주고 메타데이터를 meta에 복사한다.
+ *    (메타는 재검증 시 바뀔 수 있으므로 락 안에서 스냅샷)
+ *  - 사용이 끝나면 반드시 cache_release().
+ */
+cache_entry_t *cache_lookup(const char *key, const char *req_hdrs, cache_meta_t *meta)
+{
+  cache_entry_t *e;
+  dbuf_t sec = {0};
+
+  pthread_rwlock_rdlock(&cache_lock);
+  if ((e = match_locked(key, req_hdrs, &sec)) != NULL)
+  {
+    __atomic_add_fetch(&e->refcnt, 1, __ATOMIC_RELAXED);
+    if (meta)
+      *meta = e->meta;
+
+    /* LRU 갱신 — 맨 앞으로 */
+    pthread_mutex_lock(&lru_lock);
+    if (lru_head != e)
+    {
+      lru_unlink(e);
+      lru_push_front(e);
+    }
+    pthread_mutex_unlock(&lru_lock);
+  }
+  pthread_rwlock_unlock(&cache_lock);
+  dbuf_free(&sec);
+  return e;
+}
+
+/* 이미 참조를 가진 스레드가 다른 스레드에 넘길 참조를 하나 더 만든다 */
+cache_entry_t *cache_retain(cache_entry_t *e)
+{
+  __atomic_add_fetch(&e->refcnt, 1, __ATOMIC_RELAXED);
+  return e;
+}
+
+void cache_release(cache_entry_t *e)
+{
+  if (e)
+    entry_put(e);
+}
+
+/*
+ * cache_header_len(data, size)
+ *  - 저장된 응답에서 헤더 블록 끝(빈 줄 "\r\n" 직전)까지의 길이.
+ *  - 빈 줄이 없으면(HTTP 응답이 아니면) 0.
+ */
+size_t cache_header_len(const char *data, size_t size)
+{
+  const char *p = memmem(data, size, "\r\n\r\n", 4);
+
+  return p ? (size_t)(p - data) + 2 : 0;
+}
+
+/*
+ * 원서버에서 받은(힙) 본문을 넣는 기본 경로 — 공유 캐시가 켜져 있으면 게시도 한다
+ * (Vary 변형은 URL만으로 찾는 공유 캐시에 올리지 않는다)
+ */
+void cache_insert(const char *key, char *data, size_t size, const cache_meta_t *meta)
+{
+  if (shm_enabled() && !meta->vary[0])
+    shm_store(key, data, size, meta);
+  cache_insert_with(key, data, size, meta, NULL, 0);
+}
+
+/* 원서버에서 받았지만 본문이 힙이 아닌 곳(memfd 매핑 등)에 있을 때 */
+void cache_insert_mapped(const char *key, char *data, size_t size, const cache_meta_t *meta,
+                         cache_release_fn release)
+{
+  if (shm_enabled() && !meta->vary[0])
+    shm_store(key, data, size, meta);
+  cache_insert_with(key, data, size, meta, release, 0);
+}
+
+/*
+ * trim_variants_locked(key, vary)
+ *  - key의 URL에 새 변형을 하나 넣기 전에 자리를 만든다(write lock 보유).
+ */
+static void trim_variants_locked(const char *key, const char *vary)
+{
+  size_t ulen = strcspn(key, "\x1f");
+  cache_entry_t *e, *next, *oldest = NULL;
+  int n = 0;
+
+  for (e = buckets[hash_key(key)]; e; e = next)
+  {
+    next = e->hnext;
+    if (!same_url(e, key, ulen))
+      continue;
+    if (strcmp(e->meta.vary, vary))
+      unlink_locked(e); /* 원서버의 Vary 목록이 바뀌었다 */
+    else
+    {
+      n++;
+      oldest = e;
+    }
+  }
+  if (n >= CACHE_MAX_VARIANTS)
+  {
+    unlink_locked(oldest);
+    STAT_INC(vary_evicted);
+  }
+}
+
+/*
+ * cache_insert_with(key, data, size, meta, release, evict_at)
+ *  - data의 소유권을 캐시가 가져간다(거절되면 여기서 release/free).
+ *  - release: 본문 해제 함수(NULL이면 free)
+ *  - evict_at: 만료 인덱스 키를 직접 지정(0이면 meta로 계산)
+ *  - 같은 키가 있으면 교체, 공간이 부족하면 LRU 꼬리부터 퇴출.
+ *  - 같은 URL의 다른 변형은 Vary 목록이 다르면 버리고, CACHE_MAX_VARIANTS개를
+ *    넘으면 가장 먼저 들어온 것(체인의 뒤쪽)부터 버린다.
+ *  - 디스크 2차 캐시가 켜져 있으면 퇴출된 객체(아직 쓸모 있는 것)는
+ *    락을 놓은 뒤 디스크로 내린다(디스크 I/O를 write lock 밖으로).
+ */
+void cache_insert_with(const char *key, char *data, size_t size, const cache_meta_t *meta,
+                       cache_release_fn release, time_t evict_at)
+{
+  cache_entry_t *e, *old, *victims = NULL;
+
+  if (size > MAX_OBJECT_SIZE)
+  {
+    if (release)
+      release(data, size);
+    else
+      free(data);
+    return;
+  }
+
+  e = Calloc(1, sizeof(*e));
+  e->key = strdup(key);
+  e->data = data;
+  e->size = size;
+  e->hdr_len = cache_header_len(data, size);
+  e->release = release;
+  e->meta = *meta;
+  e->evict_at = evict_at ? evict_at : cache_evict_time(meta);
+  e->refcnt = 1; /* 인덱스 참조 */
+
+  pthread_rwlock_wrlock(&cache_lock);
+  if ((old = find_locked(key)) != NULL)
+    unlink_locked(old);
+  trim_variants_locked(key, meta->vary);
+  while (cache_bytes + size > MAX_CACHE_SIZE && lru_tail)
+  {
+    cache_entry_t *v = cache_retain(lru_tail);
+    unlink_locked(v);
+    v->hnext = victims; /* 인덱스에서 빠졌으므로 체인 링크를 재사용 */
+    victims = v;
+  }
+
+  unsigned h = hash_key(key);
+  e->hnext = buckets[h];
+  buckets[h] = e;
+  pthread_mutex_lock(&lru_lock);
+  lru_push_front(e);
+  pthread_mutex_unlock(&lru_lock);
+  heap_push(e);
+  cache_bytes += size;
+  pthread_rwlock_unlock(&cache_lock);
+
+  time_t now = time(NULL);
+  while (victims)
+  {
+    cache_entry_t *v = victims;
+    victims = v->hnext;
+    if (disk_enabled() && v->evict_at > now && !v->meta.vary[0])
+      disk_store(v->key, v->data, v->size, v->hdr_len, &v->meta);
+    entry_put(v);
+  }
+}
+
+/*
+ * cache_collect(n, metas)
+ *  - 지금 들어 있는 엔트리 전부를 LRU의 오래된 쪽부터 참조를 잡아 배열로 돌려준다.
+ *  - *metas에는 같은 순서로 각 엔트리 메타의 복사본을 담는다.
+ *    (e->meta는 cache_refresh가 write lock 아래서 바꾸므로 read lock 안에서 복사한다)
+ *  - 호출자는 각 엔트리를 cache_release() 하고 두 배열을 free 한다.
+ */
+cache_entry_t **cache_collect(int *n, cache_meta_t **metas)
+{
+  cache_entry_t **arr, *e;
+  cache_meta_t *m;
+  int cnt = 0;
+
+  pthread_rwlock_rdlock(&cache_lock);
+  pthread_mutex_lock(&lru_lock);
+  for (e = lru_tail; e; e = e->prev)
+    cnt++;
+  arr = Malloc((cnt ? cnt : 1) * sizeof(*arr));
+  m = Malloc((cnt ? cnt : 1) * sizeof(*m));
+  cnt = 0;
+  for (e = lru_tail; e; e = e->prev)
+  {
+    m[cnt] = e->meta;
+    arr[cnt++] = cache_retain(e);
+  }
+  pthread_mutex_unlock(&lru_lock);
+  pthread_rwlock_unlock(&cache_lock);
+
+  *n = cnt;
+  *metas = m;
+  return arr;
+}
+
+/* 304 재검증 성공 — 본문은 그대로 두고 메타만 교체 */
+void cache_refresh(cache_entry_t *e, const cache_meta_t *meta)
+{
+  pthread_rwlock_wrlock(&cache_lock);
+  e->meta = *meta;
+  e->evict_at = cache_evict_time(meta);
+  if (e->heap_idx >= 0) /* 이미 퇴출된 엔트리면 힙에 없다 */
+    heap_fix(e);
+  pthread_rwlock_unlock(&cache_lock);
+
+  if (shm_enabled())
+    shm_update_meta(e->key, meta);
+}
+
+/*
+ * cache_expire(now, max, nobj)
+ *  - evict_at <= now 인 엔트리를 힙 꼭대기부터 최대 max개 퇴출한다.
+ *  - write lock은 이 한 번의 배치 동안만 잡는다.
+ *  - 반환: 회수한 바이트 수 (nobj에는 퇴출 개수)
+ */
+size_t cache_expire(time_t now, int max, int *nobj)
+{
+  size_t bytes = 0;
+  int n = 0;
+
+  pthread_rwlock_wrlock(&cache_lock);
+  while (n < max && heap_len > 0 && heap[0]->evict_at <= now)
+  {
+    bytes += heap[0]->size;
+    unlink_locked(heap[0]);
+    n++;
+  }
+  pthread_rwlock_unlock(&cache_lock);
+
+  *nobj = n;
+  return bytes;
+}
+
+/*
+ * janitor_thread
+ *  - CACHE_JANITOR_INTERVAL초마다 만료 엔트리를 배치 단위로 정리한다.
+ *  - 배치가 꽉 찼으면(더 남았을 수 있음) 락을 놓았다가 바로 다음 배치.
+ *  - sweep마다 회수한 바이트를 로그와 카운터로 남긴다.
+ */
+static void *janitor_thread(void *vargp)
+{
+  Pthread_detach(pthread_self());
+  while (1)
+  {
+    size_t bytes = 0, got;
+    int total = 0, n;
+    time_t now = time(NULL);
+
+    do
+    {
+      got = cache_expire(now, CACHE_JANITOR_BATCH, &n);
+      bytes += got;
+      total += n;
+    } while (n == CACHE_JANITOR_BATCH);
+
+    if (total > 0)
+    {
+      STAT_INC(janitor_sweeps);
+      STAT_ADD(janitor_evicted, total);
+      STAT_ADD(janitor_bytes, (long)bytes);
+      printf("janitor: evicted %d expired objects, reclaimed %zu bytes\n", total, bytes);
+    }
+    sleep(CACHE_JANITOR_INTERVAL);
+  }
+  return NULL;
+}
+
+void cache_janitor_start(void)
+{
+  pthread_t tid;
+
+  Pthread_create(&tid, NULL, janitor_thread, NULL);
+}
+
+void cache_remove(const char *key)
+{
+  cache_entry_t *e;
+
+  pthread_rwlock_wrlock(&cache_lock);
+  if ((e = find_locked(key)) != NULL)
+    unlink_locked(e);
+  pthread_rwlock_unlock(&cache_lock);
+}
+
+/*
+ * cache_storable(m)
+ *  - 공유 캐시에 저장해도 되는 응답인지.
+ *  - 200과 404 / 410(네거티브 캐시)만 저장, no-store / private 는 저장 금지.
+ *    (no-cache는 저장하되 lifetime 0 → 매번 재검증)
+ *  - -N status=0 이면 명시적 수명(s-maxage/max-age/Expires)이 없는 404 / 410은
+ *    저장하지 않는다(수명 0으로 자리만 차지하고 stale-if-error로 나가지 않게).
+ *  - Set-Cookie가 붙은 응답은 사용자별 상태이므로 저장하지 않는다.
+ *  - Vary: * 는 어떤 요청에도 재사용할 수 없으므로 저장하지 않는다.
+ */
+int cache_storable(const http_meta_t *m)
+{
+  int negative = m->status == 404 || m->status == 410;
+
+  if (negative && neg_status_ttl() == 0 && m->s_maxage < 0 && m->max_age < 0 &&
+      !m->has_expires)
+    return 0;
+  return (m->status == 200 || negative) && !m->no_store && !m->is_private && !m->set_cookie &&
+         !m->vary_star;
+}
+
+/*
+ * cache_fits(m, hdr_len)
+ *  - 헤더만 보고 객체 크기 상한을 판단한다.
+ *  - Content-Length를 알면 (저장할 헤더 블록 + 본문) <= MAX_OBJECT_SIZE 인지,
+ *    모르면 일단 1(받으면서 넘치면 그때 포기).
+ */
+int cache_fits(const http_meta_t *m, size_t hdr_len)
+{
+  if (hdr_len > MAX_OBJECT_SIZE)
+    return 0;
+  return m->chunked || m->content_length < 0 ||
+         (size_t)m->content_length <= MAX_OBJECT_SIZE - hdr_len;
+}
+
+/*
+ * freshness_lifetime 계산 (RFC 9111 §4.2.1)
+ *  - 404 / 410 은 명시적 수명이 없으면 휴리스틱 대신 네거티브 TTL(-N status=)
+ */
+static long freshness_lifetime(const http_meta_t *m, time_t date)
+{
+  if (m->no_cache)
+    return 0;
+  if (m->s_maxage >= 0)
+    return m->s_maxage;
+  if (m->max_age >= 0)
+    return m->max_age;
+  if (m->has_expires)
+    return m->expires > date ? (long)(m->expires - date) : 0;
+  if (m->status == 404 || m->status == 410)
+    return neg_status_ttl();
+  if (m->last_modified && m->last_modified < date)
+    return (long)(date - m->last_modified) / CACHE_HEURISTIC_DIV;
+  return CACHE_DEFAULT_TTL;
+}
+
+/* corrected_initial_age 계산 (RFC 9111 §4.2.3) */
+static long initial_age(const http_meta_t *m, time_t request_time, time_t response_time)
+{
+  time_t date = m->date ? m->date : response_time;
+  long apparent = response_time > date ? (long)(response_time - date) : 0;
+  long corrected = m->age + (long)(response_time - request_time);
+
+  return apparent > corrected ? apparent : corrected;
+}
+
+/* 새로 받은 200 응답으로 메타데이터를 채운다 */
+void cache_meta_init(cache_meta_t *cm, const http_meta_t *m,
+                     time_t request_time, time_t response_time)
+{
+  memset(cm, 0, sizeof(*cm));
+  cm->status = m->status;
+  cm->request_time = request_time;
+  cm->response_time = response_time;
+  cm->initial_age = initial_age(m, request_time, response_time);
+  cm->lifetime = freshness_lifetime(m, m->date ? m->date : response_time);
+  cm->swr = m->stale_while_revalidate > 0 ? m->stale_while_revalidate : 0;
+  cm->sie = m->stale_if_error > 0 ? m->stale_if_error : 0;
+  cm->must_revalidate = m->must_revalidate;
+  strcpy(cm->etag, m->etag);
+  strcpy(cm->last_modified, m->last_modified_str);
+  strcpy(cm->vary, m->vary);
+}
+
+/*
+ * cache_meta_revalidate(cm, m, ...)
+ *  - 304 Not Modified로 기존 메타데이터를 갱신한다(RFC 9111 §4.3.4).
+ *  - 304에 신선도 정보가 없으면 기존 lifetime을 유지하고 나이만 새로 잰다.
+ */
+void cache_meta_revalidate(cache_meta_t *cm, const http_meta_t *m,
+                           time_t request_time, time_t response_time)
+{
+  cm->request_time = request_time;
+  cm->response_time = response_time;
+  cm->initial_age = initial_age(m, request_time, response_time);
+  if (m->s_maxage >= 0 || m->max_age >= 0 || m->has_expires || m->no_cache)
+    cm->lifetime = freshness_lifetime(m, m->date ? m->date : response_time);
+  if (m->stale_while_revalidate >= 0)
+    cm->swr = m->stale_while_revalidate;
+  if (m->stale_if_error >= 0)
+    cm->sie = m->stale_if_error;
+  if (m->must_revalidate)
+    cm->must_revalidate = 1;
+  if (m->etag[0])
+    strcpy(cm->etag, m->etag);
+  if (m->last_modified_str[0])
+    strcpy(cm->last_modified, m->last_modified_str);
+}
+
+long cache_current_age(const cache_meta_t *cm, time_t now)
+{
+  long resident = now > cm->response_time ? (long)(now - cm->response_time) : 0;
+
+  return cm->initial_age + resident;
+}
+
+int cache_is_fresh(const cache_meta_t *cm, time_t now)
+{
+  return cm->lifetime > cache_current_age(cm, now);
+}
+
+/*
+ * cache_can_serve_stale(cm, now, window)
+ *  - 만료된 지 window초 이내이고 must-revalidate가 아니면 stale 본문을 줄 수 있다.
+ *  - window는 cm->swr(stale-while-revalidate) 또는 cm->sie(stale-if-error).
+ */
+int cache_can_serve_stale(const cache_meta_t *cm, time_t now, long window)
+{
+  return !cm->must_revalidate && window > 0 &&
+         cache_current_age(cm, now) < cm->lifetime + window;
+}
+
+int cache_begin_refresh(cache_entry_t *e)
+{
+  return __atomic_exchange_n(&e->refreshing, 1, __ATOMIC_ACQ_REL) == 0;
+}
+
+void cache_end_refresh(cache_entry_t *e)
+{
+  __atomic_store_n(&e->refreshing, 0, __ATOMIC_RELEASE);
+}
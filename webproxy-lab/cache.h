@@ -0,0 +1,144 @@
+/*
+ * cache.h — 프록시 메모리 캐시 (Part III) + HTTP 신선도(freshness) 모델
+ *
+ * ✅ 구조
+ *   - 키: 정규화된 URL ("http://host:port/path")
+ *         Vary가 붙은 응답은 URL 뒤에 변형 키(2차 키)를 이어 붙인 것
+ *         ("<URL>\x1faccept-encoding=gzip\x1faccept-language=ko")
+ *   - 값: 원서버 응답 전체(상태줄 + 헤더 + 본문), 객체당 ≤ MAX_OBJECT_SIZE
+ *   - 전체 용량 ≤ MAX_CACHE_SIZE (메타데이터 제외), 초과 시 LRU 퇴출
+ *   - 해시 버킷 + LRU 이중 연결 리스트
+ *   - 헤더 블록은 Age / X-Cache 를 뺀 채 저장하고 끝 위치(hdr_len)를 기억한다.
+ *     히트는 [헤더 블록][Age/X-Cache + 빈 줄][본문] 세 조각을 writev 한 번으로
+ *     캐시 메모리에서 바로 보낸다(유저 공간 복사 없음).
+ *
+ * ✅ Vary 변형 (RFC 9111 §4.1)
+ *   - 한 URL에 요청 헤더별로 다른 응답(예: Accept-Encoding)을 여러 개 둔다.
+ *   - 2차 키 = Vary가 가리키는 요청 헤더 값들. 변형은 URL 부분만 해시하므로
+ *     모두 같은 체인에 모이고, 조회는 체인에서 URL이 같은 엔트리의 Vary 목록으로
+ *     요청의 2차 키를 계산해 비교한다.
+ *   - URL당 변형은 CACHE_MAX_VARIANTS개까지(넘으면 가장 먼저 들어온 것부터 퇴출).
+ *     원서버의 Vary 목록이 바뀌면 이전 목록으로 만든 변형은 모두 버린다.
+ *   - 변형은 프로세스 로컬 메모리 캐시(와 스냅샷)에만 둔다. 디스크/공유 캐시는
+ *     URL만으로 찾으므로 Vary 없는 응답만 내린다/게시한다.
+ *
+ * ✅ 락
+ *   - 인덱스(해시/LRU 소속)는 pthread_rwlock_t 하나로 보호
+ *       조회: read lock (여러 스레드 동시 허용)
+ *       삽입/퇴출/메타 갱신: write lock
+ *   - 히트 시 LRU 위치 갱신은 별도의 짧은 mutex(lru_lock)로 처리
+ *   - 엔트리는 참조 카운트로 수명 관리 — 락을 놓은 뒤에도 전송 중인 객체가
+ *     퇴출되어 해제되지 않는다(인덱스도 참조 1개를 가진다).
+ *
+ * ✅ 신선도 (RFC 9111 §4.2)
+ *   - freshness_lifetime: s-maxage > max-age > Expires - Date > 휴리스틱
+ *   - current_age = corrected_initial_age + (now - response_time)
+ *   - current_age < lifetime 이면 fresh, 아니면 stale → 조건부 재검증
+ *   - stale-while-revalidate 창 안이면 stale 본문을 바로 주고 백그라운드 갱신,
+ *     stale-if-error 창 안이면 원서버 오류 시 stale 본문으로 대신 응답 (RFC 5861)
+ *
+ * ✅ 만료 인덱스 (min-heap)
+ *   - 엔트리마다 "더 이상 쓸모없어지는 시각"(evict_at)을 계산해 힙에 넣는다.
+ *       evict_at = 신선도 만료 + max(SWR, SIE) 창 (+ 검증자가 있으면 재검증 유예)
+ *   - janitor 스레드가 주기적으로 힙 꼭대기부터 evict_at이 지난 엔트리를
+ *     CACHE_JANITOR_BATCH개씩 끊어서 퇴출한다(write lock을 짧게만 잡는다).
+ *   - 전체를 훑거나 LRU 압박을 기다리지 않아도 만료 객체가 정리된다.
+ */
+#ifndef __CACHE_H__
+#define __CACHE_H__
+
+#include "csapp.h"
+#include "http.h"
+
+#define MAX_CACHE_SIZE 1049000
+#define MAX_OBJECT_SIZE 102400
+
+/* 해시 버킷 수 */
+#define CACHE_BUCKETS 1024
+
+/* URL 하나에 둘 수 있는 Vary 변형 수 */
+#define CACHE_MAX_VARIANTS 4
+
+/* 신선도 정보(Cache-Control/Expires/Last-Modified)가 전혀 없을 때의 수명(초) */
+#define CACHE_DEFAULT_TTL 300
+
+/* Last-Modified 기반 휴리스틱: (Date - Last-Modified) / 10 */
+#define CACHE_HEURISTIC_DIV 10
+
+/* 검증자(ETag/Last-Modified)가 있는 만료 엔트리를 304 재검증용으로 남겨두는 시간(초) */
+#define CACHE_REVALIDATE_GRACE 60
+
+/* janitor: 주기(초)와 write lock 한 번에 퇴출할 최대 개수 */
+#define CACHE_JANITOR_INTERVAL 1
+#define CACHE_JANITOR_BATCH 32
+
+/* 엔트리별 신선도/검증자 메타데이터 */
+typedef struct
+{
+  int status;           /* 저장된 응답의 상태 코드(200 / 404 / 410) */
+  time_t request_time;  /* 원서버에 요청을 보낸 시각 */
+  time_t response_time; /* 응답(또는 304)을 받은 시각 */
+  long initial_age;     /* corrected_initial_age */
+  long lifetime;        /* freshness_lifetime(초) */
+  long swr;             /* stale-while-revalidate 창(초, 없으면 0) */
+  long sie;             /* stale-if-error 창(초, 없으면 0) */
+  int must_revalidate;  /* 설정되면 stale 본문을 절대 내보내지 않는다 */
+  char etag[HTTP_VALIDATOR_LEN];
+  char last_modified[HTTP_VALIDATOR_LEN];
+  char vary[HTTP_VARY_LEN]; /* 응답의 Vary 목록(정규화, 변형 키 계산용) */
+} cache_meta_t;
+
+/* 엔트리 본문 해제 함수 — 힙이 아닌 곳(스냅샷 mmap 등)에 있는 본문용 */
+typedef void (*cache_release_fn)(char *data, size_t size);
+
+typedef struct cache_entry
+{
+  char *key;
+  char *data;  /* 응답 전체 */
+  size_t size; /* data 길이(용량 계산 단위) */
+  size_t hdr_len; /* 헤더 블록 길이(마지막 빈 줄 제외, 0이면 data를 통째로 전송) */
+  cache_release_fn release; /* NULL이면 free(data) */
+  cache_meta_t meta;
+
+  int refcnt;     /* 인덱스 1 + 사용 중인 스레드 수 */
+  int refreshing; /* 백그라운드 갱신이 이미 예약됨(중복 예약 방지) */
+  time_t evict_at; /* 만료 인덱스 키 */
+  int heap_idx;    /* 만료 힙에서의 위치 */
+  struct cache_entry *hnext;           /* 해시 체인 */
+  struct cache_entry *prev, *next;     /* LRU (head = 최근) */
+} cache_entry_t;
+
+void cache_init(void);
+void cache_janitor_start(void);
+size_t cache_expire(time_t now, int max, int *nobj);
+cache_entry_t *cache_lookup(const char *key, const char *req_hdrs, cache_meta_t *meta);
+void cache_variant_key(dbuf_t *out, const char *key, const char *vary, const char *req_hdrs);
+cache_entry_t *cache_retain(cache_entry_t *e);
+void cache_release(cache_entry_t *e);
+void cache_insert(const char *key, char *data, size_t size, const cache_meta_t *meta);
+void cache_insert_with(const char *key, char *data, size_t size, const cache_meta_t *meta,
+                       cache_release_fn release, time_t evict_at);
+void cache_insert_mapped(const char *key, char *data, size_t size, const cache_meta_t *meta,
+                         cache_release_fn release);
+cache_entry_t **cache_collect(int *n, cache_meta_t **metas);
+void cache_refresh(cache_entry_t *e, const cache_meta_t *meta);
+void cache_remove(const char *key);
+size_t cache_header_len(const char *data, size_t size);
+
+/* 신선도 계산 */
+int cache_storable(const http_meta_t *m);
+int cache_fits(const http_meta_t *m, size_t hdr_len);
+void cache_meta_init(cache_meta_t *cm, const http_meta_t *m,
+                     time_t request_time, time_t response_time);
+void cache_meta_revalidate(cache_meta_t *cm, const http_meta_t *m,
+                           time_t request_time, time_t response_time);
+long cache_current_age(const cache_meta_t *cm, time_t now);
+int cache_is_fresh(const cache_meta_t *cm, time_t now);
+int cache_can_serve_stale(const cache_meta_t *cm, time_t now, long window);
+time_t cache_evict_time(const cache_meta_t *cm);
+
+/* 백그라운드 갱신 예약 표시(성공 시 1 — 이 호출자만 갱신을 예약한다) */
+int cache_begin_refresh(cache_entry_t *e);
+void cache_end_refresh(cache_entry_t *e);
+
+#endif /* __CACHE_H__ */
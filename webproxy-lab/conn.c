@@ -0,0 +1,248 @@
+/*
+ * conn.c — conn_t 풀과 dbuf_t(증가형 버퍼) 구현
+ *
+ * ✅ 풀 구조
+ *   - CONN_SLAB개씩 한 번에 할당한 슬랩(arena)에서 conn_t를 잘라 쓴다.
+ *   - 반납된 conn_t는 free list에 쌓였다가 다음 연결에서 재사용된다.
+ *   - 슬랩은 OS에 돌려주지 않는다(연결 수 최고점만큼만 유지).
+ *
+ * ✅ 버퍼 크기
+ *   - 모든 버퍼는 처음엔 비어 있고(cap 0), 실제로 쓰일 때 필요한 만큼만 커진다.
+ *   - 반납 시 CONN_BUF_KEEP보다 커진 버퍼는 해제해서 풀이 부풀지 않게 한다.
+ */
+#include "conn.h"
+
+/* 처음 할당할 때의 최소 용량 */
+#define DBUF_MIN 64
+
+static conn_t *free_list = NULL;
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * dbuf_reserve(b, need)
+ *  - 최소 need 바이트(+ '\0' 1바이트)를 담을 수 있게 용량을 늘린다.
+ *  - 2배씩 키워서 append 반복 비용을 상각 O(1)로 유지.
+ */
+void dbuf_reserve(dbuf_t *b, size_t need)
+{
+  size_t cap;
+
+  if (need + 1 <= b->cap)
+    return;
+  cap = b->cap ? b->cap : DBUF_MIN;
+  while (cap < need + 1)
+    cap *= 2;
+  b->data = Realloc(b->data, cap);
+  b->cap = cap;
+}
+
+/* 최종 길이를 미리 알 때 — 정확히 need(+NUL)만큼 잡아 이후 재할당이 없게 */
+void dbuf_reserve_exact(dbuf_t *b, size_t need)
+{
+  if (need + 1 <= b->cap)
+    return;
+  b->data = Realloc(b->data, need + 1);
+  b->cap = need + 1;
+}
+
+void dbuf_append(dbuf_t *b, const void *p, size_t n)
+{
+  dbuf_reserve(b, b->len + n);
+  memcpy(b->data + b->len, p, n);
+  b->len += n;
+  b->data[b->len] = '\0';
+}
+
+void dbuf_puts(dbuf_t *b, const char *s)
+{
+  dbuf_append(b, s, strlen(s));
+}
+
+/* printf 형식으로 뒤에 이어 쓴다(길이를 먼저 재고 정확히 그만큼 확보) */
+void dbuf_printf(dbuf_t *b, const char *fmt, ...)
+{
+  va_list ap;
+  int n;
+
+  va_start(ap, fmt);
+  n = vsnprintf(NULL, 0, fmt, ap);
+  va_end(ap);
+  if (n < 0)
+    return;
+
+  dbuf_reserve(b, b->len + (size_t)n);
+  va_start(ap, fmt);
+  vsnprintf(b->data + b->len, (size_t)n + 1, fmt, ap);
+  va_end(ap);
+  b->len += (size_t)n;
+}
+
+/* 내용을 s[0..n) 으로 교체 */
+void dbuf_set(dbuf_t *b, const char *s, size_t n)
+{
+  b->len = 0;
+  dbuf_append(b, s, n);
+}
+
+/* 용량은 유지하고 내용만 비운다 */
+void dbuf_reset(dbuf_t *b)
+{
+  b->len = 0;
+  if (b->data)
+    b->data[0] = '\0';
+}
+
+/* keep보다 큰 버퍼는 해제, 작으면 비우기만 */
+void dbuf_trim(dbuf_t *b, size_t keep)
+{
+  if (b->cap > keep)
+    dbuf_free(b);
+  else
+    dbuf_reset(b);
+}
+
+void dbuf_free(dbuf_t *b)
+{
+  free(b->data);
+  b->data = NULL;
+  b->len = b->cap = 0;
+}
+
+/*
+ * conn_get(fd)
+ *  - 풀에서 conn_t 하나를 꺼내 fd에 묶는다.
+ *  - free list가 비었으면 슬랩 하나(CONN_SLAB개)를 새로 만들어 채운다.
+ */
+conn_t *conn_get(int fd)
+{
+  conn_t *c;
+
+  pthread_mutex_lock(&pool_lock);
+  if (!free_list)
+  {
+    conn_t *slab = Calloc(CONN_SLAB, sizeof(conn_t));
+    for (int i = 0; i < CONN_SLAB; i++)
+    {
+      slab[i].next = free_list;
+      free_list = &slab[i];
+    }
+  }
+  c = free_list;
+  free_list = c->next;
+  pthread_mutex_unlock(&pool_lock);
+
+  c->fd = fd;
+  c->next = NULL;
+  Rio_readinitb(&c->rio, fd);
+  return c;
+}
+
+/*
+ * conn_put(c)
+ *  - 버퍼를 정리한 뒤 conn_t를 풀에 돌려준다.
+ *  - fd는 닫지 않는다(호출자가 Close).
+ */
+void conn_put(conn_t *c)
+{
+  dbuf_t *bufs[] = {&c->line, &c->method, &c->uri, &c->version,
+                    &c->host_header, &c->other_header, &c->cond_header,
+                    &c->range_header,
+                    &c->hostname, &c->port, &c->path, &c->key, &c->vkey,
+                    &c->req, &c->rhdr};
+
+  for (size_t i = 0; i < sizeof(bufs) / sizeof(bufs[0]); i++)
+    dbuf_trim(bufs[i], CONN_BUF_KEEP);
+  c->fd = -1;
+
+  pthread_mutex_lock(&pool_lock);
+  c->next = free_list;
+  free_list = c;
+  pthread_mutex_unlock(&pool_lock);
+}
+
+/*
+ * dbuf_readline(rp, b)
+ *  - rp(클라이언트 또는 원서버)에서 한 줄('\n' 포함)을 읽어 b에 담는다.
+ *  - 버퍼는 줄 길이에 맞춰 늘어나며, 한 줄은 최대 MAXLINE-1 바이트
+ *    (기존 Rio_readlineb(..., MAXLINE) 과 같은 상한).
+ *  - 읽기 오류(원서버 RST 등)에 프로세스가 죽지 않도록 종료하지 않는
+ *    rio_readlineb를 쓴다.
+ *  - 반환: 읽은 바이트 수, EOF면 0, 오류면 -1
+ */
+ssize_t dbuf_readline(rio_t *rp, dbuf_t *b)
+{
+  ssize_t n;
+
+  dbuf_reset(b);
+  while (b->len < MAXLINE - 1)
+  {
+    size_t room;
+
+    dbuf_reserve(b, b->len < DBUF_MIN ? DBUF_MIN : b->len * 2);
+    room = b->cap - b->len; /* rio_readlineb는 room-1 바이트 + '\0' */
+    if (b->len + room > MAXLINE)
+      room = MAXLINE - b->len;
+
+    if ((n = rio_readlineb(rp, b->data + b->len, room)) < 0)
+      return -1;
+    if (n == 0)
+      break;
+    b->len += (size_t)n;
+    if (b->data[b->len - 1] == '\n')
+      break;
+  }
+  return (ssize_t)b->len;
+}
+
+/*
+ * conn_rio_fill(rp)
+ *  - RIO 버퍼가 비었으면 소켓에서 한 번 채운다(rio_read와 같은 방식).
+ *  - RIO 버퍼를 직접 훑는 코드(본문 조각, 헤더 건너뛰기)가 쓴다.
+ *  - 반환: 버퍼에 남은 바이트 수, EOF면 0, 오류면 -1
+ */
+ssize_t conn_rio_fill(rio_t *rp)
+{
+  while (rp->rio_cnt <= 0)
+  {
+    rp->rio_cnt = read(rp->rio_fd, rp->rio_buf, sizeof(rp->rio_buf));
+    if (rp->rio_cnt < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      return -1;
+    }
+    if (rp->rio_cnt == 0)
+      return 0;
+    rp->rio_bufptr = rp->rio_buf;
+  }
+  return rp->rio_cnt;
+}
+
+/*
+ * conn_writev(fd, iov, cnt)
+ *  - writev로 iov 전부를 보낸다(부분 전송이면 남은 부분부터 이어서).
+ *  - iov 배열은 진행에 따라 수정된다.
+ *  - 반환: 성공 0, 오류(클라이언트가 끊음 등) -1
+ */
+int conn_writev(int fd, struct iovec *iov, int cnt)
+{
+  while (cnt > 0)
+  {
+    ssize_t n = writev(fd, iov, cnt);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0)
+      return -1;
+    while (cnt > 0 && (size_t)n >= iov->iov_len)
+    {
+      n -= iov->iov_len;
+      iov++, cnt--;
+    }
+    if (cnt > 0)
+    {
+      iov->iov_base = (char *)iov->iov_base + n;
+      iov->iov_len -= n;
+    }
+  }
+  return 0;
+}
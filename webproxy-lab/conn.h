@@ -0,0 +1,73 @@
+/*
+ * conn.h — 연결(커넥션) 단위 상태 객체와 증가형 버퍼
+ *
+ * ✅ 왜 필요한가?
+ *   - doit()이 스택에 char[MAXLINE] 배열을 10개 가까이 올리면
+ *     스레드마다 ~80KiB 스택이 필요해지고, 동시 연결 수가 메모리에 묶인다.
+ *   - 연결에 필요한 모든 버퍼를 힙의 conn_t 하나에 모으고,
+ *     버퍼는 실제 길이만큼만 커지는 dbuf_t로 둔다.
+ *   - conn_t는 풀(슬랩 단위 arena)에서 꺼내 쓰고 반납하므로
+ *     연결마다 malloc/free 를 반복하지 않는다.
+ */
+#ifndef __CONN_H__
+#define __CONN_H__
+
+#include "csapp.h"
+#include <sys/uio.h>
+
+/* 스레드 스택 크기 — 큰 배열을 모두 conn_t로 옮겼으므로 작게 잡는다 */
+#define CONN_STACK_SIZE (128 * 1024)
+
+/* 풀이 한 번에 만드는 conn_t 개수(슬랩 크기) */
+#define CONN_SLAB 64
+
+/* 반납 시 이보다 큰 버퍼는 해제(한 번 큰 요청이 풀 전체를 부풀리지 않게) */
+#define CONN_BUF_KEEP MAXBUF
+
+/* 증가형 바이트 버퍼 — 항상 data[len] == '\0' 을 유지(문자열로도 사용 가능) */
+typedef struct
+{
+  char *data;
+  size_t len;
+  size_t cap;
+} dbuf_t;
+
+void dbuf_reserve(dbuf_t *b, size_t need);
+void dbuf_reserve_exact(dbuf_t *b, size_t need);
+void dbuf_append(dbuf_t *b, const void *p, size_t n);
+void dbuf_puts(dbuf_t *b, const char *s);
+void dbuf_printf(dbuf_t *b, const char *fmt, ...);
+void dbuf_set(dbuf_t *b, const char *s, size_t n);
+void dbuf_reset(dbuf_t *b);
+void dbuf_trim(dbuf_t *b, size_t keep);
+void dbuf_free(dbuf_t *b);
+ssize_t dbuf_readline(rio_t *rp, dbuf_t *b);
+ssize_t conn_rio_fill(rio_t *rp);
+int conn_writev(int fd, struct iovec *iov, int cnt);
+
+/* 연결 하나에 대한 모든 상태 */
+typedef struct conn
+{
+  int fd;     /* 클라이언트 소켓 */
+  rio_t rio;  /* 클라이언트 쪽 RIO 버퍼 */
+
+  rio_t srv_rio; /* 원서버 쪽 RIO 버퍼(응답 헤더 파싱용) */
+
+  dbuf_t line;                      /* 현재 읽고 있는 한 줄 */
+  dbuf_t method, uri, version;      /* 요청 라인 */
+  dbuf_t host_header, other_header; /* Host 한 줄과 그 외 헤더 모음 */
+  dbuf_t cond_header;               /* 클라이언트의 조건부 헤더(If-None-Match 등) */
+  dbuf_t range_header;              /* 클라이언트의 Range / If-Range */
+  dbuf_t hostname, port, path;      /* URI 분해 결과 */
+  dbuf_t key;                       /* 캐시 키(http://host:port/path) */
+  dbuf_t vkey;                      /* 저장 키(key + Vary 변형 키) */
+  dbuf_t req;                       /* 원서버로 보낼 요청 */
+  dbuf_t rhdr;                      /* 원서버 응답의 상태줄 + 헤더 */
+
+  struct conn *next; /* 풀의 free list 링크 */
+} conn_t;
+
+conn_t *conn_get(int fd);
+void conn_put(conn_t *c);
+
+#endif /* __CONN_H__ */
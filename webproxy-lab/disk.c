@@ -0,0 +1,478 @@
+/*
+ * disk.c — 디스크 2차 캐시 구현
+ *
+ * ✅ 락
+ *   - append_lock(mutex): 현재 세그먼트 끝에 덧붙이는 쓰기를 직렬화
+ *   - disk_lock(rwlock): 인덱스 해시 + 세그먼트 테이블
+ *       조회: read lock / 인덱스 교체·세그먼트 추가·삭제: write lock
+ *   - 락 순서: append_lock → disk_lock
+ *
+ * ✅ 세그먼트 수명
+ *   - 세그먼트는 참조 카운트(테이블 1 + sendfile 중인 스레드)로 관리한다.
+ *   - 버려진 세그먼트는 파일을 바로 unlink하지만, 전송 중인 fd가 있으면
+ *     마지막 참조가 풀릴 때 close된다(POSIX: 열린 파일은 unlink 후에도 읽힌다).
+ */
+#include "disk.h"
+#include "stats.h"
+#include <sys/uio.h>
+#include <sys/sendfile.h>
+#include <netinet/tcp.h>
+
+struct disk_seg
+{
+  uint32_t id;
+  int fd;
+  off_t size; /* 기록된 바이트 */
+  off_t live; /* 인덱스가 가리키는 레코드 바이트 합 */
+  int refcnt;
+};
+
+typedef struct disk_ent
+{
+  char *key;
+  disk_seg_t *seg;
+  off_t off;      /* 레코드 시작 오프셋 */
+  size_t rec_len; /* 헤더 + 키 + 데이터 */
+  size_t len;     /* 데이터(응답) 길이 */
+  size_t hdr_len; /* 그중 헤더 블록 길이 */
+  cache_meta_t meta;
+  time_t evict_at;
+  struct disk_ent *next;
+} disk_ent_t;
+
+static char *disk_dir;
+static disk_seg_t *segs[DISK_MAX_SEGS];
+static uint32_t first_id, active_id; /* 살아 있는 가장 오래된/현재 세그먼트 번호 */
+static off_t total_bytes;
+static disk_ent_t *buckets[DISK_BUCKETS];
+
+static pthread_rwlock_t disk_lock = PTHREAD_RWLOCK_INITIALIZER;
+static pthread_mutex_t append_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static unsigned hash_key(const char *key)
+{
+  unsigned h = 5381;
+
+  while (*key)
+    h = h * 33 + (unsigned char)*key++;
+  return h % DISK_BUCKETS;
+}
+
+static void seg_path(char *buf, size_t n, uint32_t id)
+{
+  snprintf(buf, n, "%s/seg-%08u", disk_dir, id);
+}
+
+static void seg_put(disk_seg_t *s)
+{
+  if (__atomic_sub_fetch(&s->refcnt, 1, __ATOMIC_ACQ_REL) == 0)
+  {
+    close(s->fd);
+    free(s);
+  }
+}
+
+static disk_ent_t *find_locked(const char *key)
+{
+  disk_ent_t *e;
+
+  for (e = buckets[hash_key(key)]; e; e = e->next)
+    if (!strcmp(e->key, key))
+      return e;
+  return NULL;
+}
+
+/*
+ * unlink_segment_locked(s)
+ *  - disk_lock(쓰기) 보유 상태에서 세그먼트를 테이블에서 빼고,
+ *    그 세그먼트를 가리키던 인덱스 항목을 모두 지운다.
+ *  - 파일 삭제와 테이블 참조 해제는 락 밖에서 retire_segment()로 한다.
+ */
+static void unlink_segment_locked(disk_seg_t *s)
+{
+  for (int b = 0; b < DISK_BUCKETS; b++)
+  {
+    disk_ent_t **pp = &buckets[b];
+    while (*pp)
+    {
+      disk_ent_t *e = *pp;
+      if (e->seg == s)
+      {
+        *pp = e->next;
+        free(e->key);
+        free(e);
+      }
+      else
+        pp = &e->next;
+    }
+  }
+  segs[s->id % DISK_MAX_SEGS] = NULL;
+  total_bytes -= s->size;
+  while (first_id < active_id && !segs[first_id % DISK_MAX_SEGS])
+    first_id++;
+}
+
+/* unlink_segment_locked()로 뺀 세그먼트의 파일을 지우고 테이블 참조를 놓는다 */
+static void retire_segment(disk_seg_t *s)
+{
+  char path[MAXLINE];
+
+  seg_path(path, sizeof(path), s->id);
+  unlink(path);
+  seg_put(s);
+}
+
+/*
+ * drop_segment(s)
+ *  - 참조를 잡고 있는 세그먼트를 버린다(compaction).
+ *  - 이미 빠진 세그먼트면 아무것도 하지 않는다(compaction과 용량 정리가 겹칠 때).
+ */
+static void drop_segment(disk_seg_t *s)
+{
+  pthread_rwlock_wrlock(&disk_lock);
+  if (segs[s->id % DISK_MAX_SEGS] != s)
+  {
+    pthread_rwlock_unlock(&disk_lock);
+    return;
+  }
+  unlink_segment_locked(s);
+  pthread_rwlock_unlock(&disk_lock);
+  retire_segment(s);
+}
+
+/*
+ * drop_slot(id)
+ *  - 번호 id의 슬롯에 있는 세그먼트를 버린다.
+ *  - 슬롯 읽기와 비우기를 한 번의 disk_lock 안에서 해서,
+ *    동시에 compaction이 버린(해제한) 세그먼트를 만지지 않는다.
+ */
+static void drop_slot(uint32_t id)
+{
+  disk_seg_t *s;
+
+  pthread_rwlock_wrlock(&disk_lock);
+  if ((s = segs[id % DISK_MAX_SEGS]) != NULL)
+    unlink_segment_locked(s);
+  pthread_rwlock_unlock(&disk_lock);
+  if (s)
+    retire_segment(s);
+}
+
+/* append_lock 보유 상태에서 호출 — 새 세그먼트를 열어 현재 세그먼트로 만든다 */
+static disk_seg_t *roll_segment(void)
+{
+  char path[MAXLINE];
+  disk_seg_t *s = Calloc(1, sizeof(*s));
+
+  s->id = ++active_id;
+  s->refcnt = 1;
+  seg_path(path, sizeof(path), s->id);
+  if ((s->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600)) < 0)
+  {
+    fprintf(stderr, "disk: cannot create %s: %s\n", path, strerror(errno));
+    active_id--;
+    free(s);
+    return NULL;
+  }
+
+  /* 번호 테이블이 한 바퀴 돌기 전에 가장 오래된 세그먼트를 비운다 */
+  drop_slot(s->id);
+
+  pthread_rwlock_wrlock(&disk_lock);
+  segs[s->id % DISK_MAX_SEGS] = s;
+  pthread_rwlock_unlock(&disk_lock);
+  return s;
+}
+
+/*
+ * append_record(key, data, len, hdr_len, meta, expect_seg, expect_off)
+ *  - 현재 세그먼트 끝에 레코드를 쓰고 인덱스를 새 위치로 바꾼다.
+ *  - expect_seg가 있으면(compaction) 인덱스가 아직 그 위치를 가리킬 때만 바꾼다.
+ *    그 사이 더 새로운 버전이 들어왔다면 방금 쓴 레코드는 그냥 죽은 바이트가 된다.
+ */
+static void append_record(const char *key, const char *data, size_t len, size_t hdr_len,
+                          const cache_meta_t *meta,
+                          disk_seg_t *expect_seg, off_t expect_off)
+{
+  disk_rec_t h;
+  struct iovec iov[3];
+  size_t klen = strlen(key);
+  size_t rec_len = sizeof(h) + klen + len;
+  disk_seg_t *s;
+  off_t off;
+
+  if (rec_len > DISK_SEGMENT_SIZE)
+    return;
+
+  memset(&h, 0, sizeof(h));
+  h.magic = DISK_MAGIC;
+  h.key_len = (uint32_t)klen;
+  h.data_len = len;
+  h.hdr_len = (uint32_t)hdr_len;
+  h.meta = *meta;
+  iov[0].iov_base = &h;
+  iov[0].iov_len = sizeof(h);
+  iov[1].iov_base = (void *)key;
+  iov[1].iov_len = klen;
+  iov[2].iov_base = (void *)data;
+  iov[2].iov_len = len;
+
+  pthread_mutex_lock(&append_lock);
+  s = segs[active_id % DISK_MAX_SEGS];
+  if (!s || s->size + (off_t)rec_len > DISK_SEGMENT_SIZE)
+    s = roll_segment();
+  if (!s)
+    goto out;
+
+  off = s->size;
+  if (pwritev(s->fd, iov, 3, off) != (ssize_t)rec_len)
+    goto out;
+
+  pthread_rwlock_wrlock(&disk_lock);
+  s->size += rec_len;
+  total_bytes += rec_len;
+
+  disk_ent_t *e = find_locked(key);
+  if (expect_seg && (!e || e->seg != expect_seg || e->off != expect_off))
+  {
+    pthread_rwlock_unlock(&disk_lock); /* 더 새로운 버전이 이미 있음 */
+    goto out;
+  }
+  if (e)
+    e->seg->live -= e->rec_len;
+  else
+  {
+    unsigned b = hash_key(key);
+    e = Calloc(1, sizeof(*e));
+    e->key = strdup(key);
+    e->next = buckets[b];
+    buckets[b] = e;
+  }
+  e->seg = s;
+  e->off = off;
+  e->rec_len = rec_len;
+  e->len = len;
+  e->hdr_len = hdr_len;
+  e->meta = *meta;
+  e->evict_at = cache_evict_time(meta);
+  s->live += rec_len;
+  pthread_rwlock_unlock(&disk_lock);
+
+  /* 용량 상한 — 가장 오래된 세그먼트부터 통째로 버린다 */
+  while (1)
+  {
+    disk_seg_t *old = NULL;
+
+    pthread_rwlock_wrlock(&disk_lock);
+    if (total_bytes > DISK_MAX_BYTES && first_id < active_id &&
+        (old = segs[first_id % DISK_MAX_SEGS]) != NULL)
+      unlink_segment_locked(old);
+    pthread_rwlock_unlock(&disk_lock);
+    if (!old)
+      break;
+    STAT_INC(disk_dropped_segs);
+    retire_segment(old);
+  }
+
+out:
+  pthread_mutex_unlock(&append_lock);
+}
+
+/*
+ * compact_segment(s)
+ *  - 세그먼트를 처음부터 훑으며 인덱스가 아직 가리키는 레코드만 현재 세그먼트로 옮긴다.
+ *  - 만료돼 쓸모없는 레코드는 옮기지 않는다.
+ *  - 다 옮기면 세그먼트를 버린다.
+ */
+static void compact_segment(disk_seg_t *s)
+{
+  disk_rec_t h;
+  char *key = NULL, *data = NULL;
+  off_t off = 0;
+  size_t moved = 0;
+  time_t now = time(NULL);
+
+  while (off < s->size)
+  {
+    if (pread(s->fd, &h, sizeof(h), off) != sizeof(h) || h.magic != DISK_MAGIC)
+      break;
+    size_t rec_len = sizeof(h) + h.key_len + h.data_len;
+
+    key = Realloc(key, h.key_len + 1);
+    if (pread(s->fd, key, h.key_len, off + sizeof(h)) != h.key_len)
+      break;
+    key[h.key_len] = '\0';
+
+    pthread_rwlock_rdlock(&disk_lock);
+    disk_ent_t *e = find_locked(key);
+    int live = e && e->seg == s && e->off == off && e->evict_at > now;
+    pthread_rwlock_unlock(&disk_lock);
+
+    if (live)
+    {
+      data = Realloc(data, h.data_len ? h.data_len : 1);
+      if (pread(s->fd, data, h.data_len, off + sizeof(h) + h.key_len) == (ssize_t)h.data_len)
+      {
+        append_record(key, data, h.data_len, h.hdr_len, &h.meta, s, off);
+        moved += rec_len;
+      }
+    }
+    off += rec_len;
+  }
+  free(key);
+  free(data);
+
+  STAT_INC(disk_compactions);
+  STAT_ADD(disk_compacted_bytes, (long)(s->size - moved));
+  printf("disk: compacted seg-%08u, moved %zu bytes, reclaimed %ld bytes\n",
+         s->id, moved, (long)(s->size - moved));
+  drop_segment(s);
+}
+
+/* compaction 스레드 — live 비율이 가장 낮은 봉인 세그먼트 하나씩 */
+static void *compact_thread(void *vargp)
+{
+  Pthread_detach(pthread_self());
+  while (1)
+  {
+    disk_seg_t *victim = NULL;
+    long best = DISK_COMPACT_RATIO;
+
+    sleep(DISK_COMPACT_INTERVAL);
+    pthread_rwlock_rdlock(&disk_lock);
+    for (uint32_t id = first_id; id < active_id; id++) /* active는 제외 */
+    {
+      disk_seg_t *s = segs[id % DISK_MAX_SEGS];
+      if (s && s->size > 0 && s->live * 100 / s->size < best)
+      {
+        best = s->live * 100 / s->size;
+        victim = s;
+      }
+    }
+    if (victim)
+      __atomic_add_fetch(&victim->refcnt, 1, __ATOMIC_RELAXED);
+    pthread_rwlock_unlock(&disk_lock);
+
+    if (victim)
+    {
+      compact_segment(victim);
+      seg_put(victim);
+    }
+  }
+  return NULL;
+}
+
+/*
+ * disk_init(dir)
+ *  - dir(없으면 생성)을 2차 캐시 디렉터리로 쓴다. 이전 실행의 세그먼트는 지운다.
+ */
+void disk_init(const char *dir)
+{
+  DIR *d;
+  struct dirent *de;
+  char path[MAXLINE];
+  pthread_t tid;
+
+  if (mkdir(dir, 0700) < 0 && errno != EEXIST)
+    unix_error("disk: mkdir error");
+  disk_dir = strdup(dir);
+
+  d = Opendir(dir);
+  while ((de = readdir(d)) != NULL)
+  {
+    if (!strncmp(de->d_name, "seg-", 4))
+    {
+      snprintf(path, sizeof(path), "%s/%s", dir, de->d_name);
+      unlink(path);
+    }
+  }
+  Closedir(d);
+
+  first_id = 1;
+  active_id = 0;
+  Pthread_create(&tid, NULL, compact_thread, NULL);
+}
+
+int disk_enabled(void)
+{
+  return disk_dir != NULL;
+}
+
+/* 메모리 캐시에서 밀려난 객체를 디스크로 내린다 */
+void disk_store(const char *key, const char *data, size_t len, size_t hdr_len,
+                const cache_meta_t *meta)
+{
+  append_record(key, data, len, hdr_len, meta, NULL, 0);
+  STAT_INC(disk_stored);
+}
+
+/*
+ * disk_lookup(key, obj)
+ *  - 히트면 1. obj는 세그먼트 참조를 잡고 있으므로 disk_release() 필수.
+ *  - 이미 쓸모없는(evict_at 지난) 레코드는 미스로 취급한다.
+ */
+int disk_lookup(const char *key, disk_obj_t *obj)
+{
+  disk_ent_t *e;
+  int hit = 0;
+
+  pthread_rwlock_rdlock(&disk_lock);
+  if ((e = find_locked(key)) != NULL && e->evict_at > time(NULL))
+  {
+    __atomic_add_fetch(&e->seg->refcnt, 1, __ATOMIC_RELAXED);
+    obj->seg = e->seg;
+    obj->data_off = e->off + sizeof(disk_rec_t) + strlen(e->key);
+    obj->len = e->len;
+    obj->hdr_len = e->hdr_len;
+    obj->meta = e->meta;
+    hit = 1;
+  }
+  pthread_rwlock_unlock(&disk_lock);
+  return hit;
+}
+
+/* 세그먼트 파일 [off, off+left) → 소켓, 커널 안에서 바로 (부분 전송이면 이어서) */
+static int send_range(int fd, disk_seg_t *s, off_t off, size_t left)
+{
+  while (left > 0)
+  {
+    ssize_t n = sendfile(fd, s->fd, &off, left);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return -1;
+    left -= (size_t)n;
+  }
+  return 0;
+}
+
+/*
+ * disk_send(fd, obj, extra, extra_len)
+ *  - 레코드의 헤더 블록 뒤에 extra(Age/X-Cache 줄 + 빈 줄)를 끼워 보낸다.
+ *  - 세 조각이 작은 패킷으로 흩어지지 않도록 TCP_CORK로 묶는다.
+ *  - 헤더 블록 위치를 모르는 레코드(hdr_len == 0)나 extra가 없으면 통째로 보낸다.
+ */
+int disk_send(int fd, const disk_obj_t *obj, const char *extra, size_t extra_len)
+{
+  int on = 1, off = 0, rc;
+
+  if (!obj->hdr_len || !extra_len)
+    return send_range(fd, obj->seg, obj->data_off, obj->len);
+
+  setsockopt(fd, IPPROTO_TCP, TCP_CORK, &on, sizeof(on));
+  rc = send_range(fd, obj->seg, obj->data_off, obj->hdr_len);
+  if (rc == 0 && rio_writen(fd, (void *)extra, extra_len) != (ssize_t)extra_len)
+    rc = -1;
+  if (rc == 0) /* 원래 빈 줄("\r\n")은 extra에 들어 있으므로 건너뛴다 */
+    rc = send_range(fd, obj->seg, obj->data_off + obj->hdr_len + 2,
+                    obj->len - obj->hdr_len - 2);
+  setsockopt(fd, IPPROTO_TCP, TCP_CORK, &off, sizeof(off));
+  return rc;
+}
+
+void disk_release(disk_obj_t *obj)
+{
+  if (obj->seg)
+    seg_put(obj->seg);
+  obj->seg = NULL;
+}
@@ -0,0 +1,66 @@
+/*
+ * disk.h — 디스크 2차 캐시 (로그 구조 세그먼트 파일)
+ *
+ * ✅ 구조
+ *   - 메모리 캐시(1MiB)에서 LRU로 밀려난 객체를 디렉터리의 세그먼트 파일
+ *     (seg-00000001 ...) 끝에 레코드로 덧붙인다(append-only).
+ *   - 메모리 인덱스: 키 → (세그먼트, 오프셋, 길이, 신선도 메타)
+ *   - 히트는 sendfile()로 세그먼트 파일에서 클라이언트 소켓으로 바로 보낸다
+ *     (유저 공간 복사 없음). 헤더 블록과 본문 사이에 Age/X-Cache 줄을 끼워야
+ *     하므로 TCP_CORK로 묶어 [sendfile 헤더][write 추가 줄][sendfile 본문]을
+ *     한 흐름으로 내보낸다.
+ *   - 세그먼트 총량이 DISK_MAX_BYTES를 넘으면 가장 오래된 세그먼트를 통째로 버린다.
+ *   - compaction 스레드: 살아 있는 바이트 비율이 낮은 봉인 세그먼트의 live 레코드를
+ *     현재 세그먼트로 옮겨 쓰고 옛 파일을 지운다.
+ *
+ * ✅ 레코드 형식
+ *   [disk_rec_t 헤더][키 key_len 바이트][응답 data_len 바이트]
+ */
+#ifndef __DISK_H__
+#define __DISK_H__
+
+#include "cache.h"
+#include <stdint.h>
+
+#ifndef DISK_SEGMENT_SIZE
+#define DISK_SEGMENT_SIZE (64 * 1024 * 1024) /* 세그먼트 하나의 최대 크기 */
+#endif
+#define DISK_MAX_BYTES (1024L * 1024 * 1024) /* 세그먼트 총량 상한 */
+#define DISK_MAX_SEGS 1024                    /* 세그먼트 번호 테이블 크기 */
+#define DISK_BUCKETS 4096                     /* 인덱스 해시 버킷 수 */
+#define DISK_COMPACT_INTERVAL 5               /* compaction 주기(초) */
+#define DISK_COMPACT_RATIO 50                 /* live 비율(%)이 이보다 낮으면 compaction */
+
+#define DISK_MAGIC 0x50524b32 /* "PRK2" */
+
+typedef struct
+{
+  uint32_t magic;
+  uint32_t key_len;
+  uint64_t data_len;
+  uint32_t hdr_len; /* data 중 헤더 블록 길이(cache_entry_t.hdr_len) */
+  uint32_t pad;
+  cache_meta_t meta;
+} disk_rec_t;
+
+typedef struct disk_seg disk_seg_t;
+
+/* disk_lookup() 결과 — 세그먼트 참조를 잡고 있으므로 disk_release() 필수 */
+typedef struct
+{
+  disk_seg_t *seg;
+  off_t data_off;
+  size_t len;
+  size_t hdr_len;
+  cache_meta_t meta;
+} disk_obj_t;
+
+void disk_init(const char *dir);
+int disk_enabled(void);
+void disk_store(const char *key, const char *data, size_t len, size_t hdr_len,
+                const cache_meta_t *meta);
+int disk_lookup(const char *key, disk_obj_t *obj);
+int disk_send(int fd, const disk_obj_t *obj, const char *extra, size_t extra_len);
+void disk_release(disk_obj_t *obj);
+
+#endif /* __DISK_H__ */
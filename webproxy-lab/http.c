@@ -0,0 +1,473 @@
+/*
+ * http.c — 원서버 응답 헤더 파싱
+ *
+ * ✅ 사용법
+ *   - 응답 첫 줄은 http_parse_status(), 이후 헤더 한 줄마다 http_parse_header().
+ *   - 모르는 헤더는 무시하고, 아는 헤더만 http_meta_t에 채운다.
+ *
+ * ⚠️ 날짜 형식
+ *   - RFC 9110의 IMF-fixdate("Sun, 06 Nov 1994 08:49:37 GMT")가 기본이고,
+ *     구형 rfc850 / asctime 형식도 받아준다.
+ */
+#include "http.h"
+
+static const char *date_formats[] = {
+    "%a, %d %b %Y %H:%M:%S GMT", /* IMF-fixdate */
+    "%A, %d-%b-%y %H:%M:%S GMT", /* rfc850 */
+    "%a %b %e %H:%M:%S %Y",      /* asctime */
+};
+
+void http_meta_init(http_meta_t *m)
+{
+  memset(m, 0, sizeof(*m));
+  m->content_length = -1;
+  m->max_age = -1;
+  m->s_maxage = -1;
+  m->stale_while_revalidate = -1;
+  m->stale_if_error = -1;
+}
+
+/*
+ * http_parse_status(line)
+ *  - "HTTP/1.x NNN reason\r\n" 에서 NNN을 꺼낸다. 형식이 아니면 0.
+ */
+int http_parse_status(const char *line)
+{
+  int major, minor, status;
+
+  if (sscanf(line, "HTTP/%d.%d %d", &major, &minor, &status) != 3)
+    return 0;
+  return status;
+}
+
+/*
+ * http_parse_date(s)
+ *  - HTTP 날짜 문자열을 time_t(UTC)로. 해석 불가면 0.
+ */
+time_t http_parse_date(const char *s)
+{
+  struct tm tm;
+
+  for (size_t i = 0; i < sizeof(date_formats) / sizeof(date_formats[0]); i++)
+  {
+    memset(&tm, 0, sizeof(tm));
+    const char *end = strptime(s, date_formats[i], &tm);
+    if (end && (*end == '\0' || isspace((unsigned char)*end)))
+      return timegm(&tm);
+  }
+  return 0;
+}
+
+/* IMF-fixdate 형식으로 출력 */
+void http_format_date(time_t t, char *buf, size_t n)
+{
+  struct tm tm;
+
+  gmtime_r(&t, &tm);
+  strftime(buf, n, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+}
+
+/* 음이 아닌 delta-seconds 파싱(형식 오류 시 -1) */
+static long parse_delta(const char *s, size_t n)
+{
+  long v = 0;
+
+  if (n >= 2 && s[0] == '"' && s[n - 1] == '"')
+    s++, n -= 2;
+  if (n == 0)
+    return -1;
+  for (size_t i = 0; i < n; i++)
+  {
+    if (!isdigit((unsigned char)s[i]))
+      return -1;
+    if (v < 0x7fffffffL / 10)
+      v = v * 10 + (s[i] - '0');
+  }
+  return v;
+}
+
+/*
+ * parse_cache_control(m, v)
+ *  - "max-age=60, no-store, private=\"Set-Cookie\"" 같은 지시자 목록을 훑는다.
+ *  - 같은 헤더가 여러 줄로 와도 누적된다.
+ */
+static void parse_cache_control(http_meta_t *m, const char *v)
+{
+  while (*v)
+  {
+    while (*v == ' ' || *v == '\t' || *v == ',')
+      v++;
+    if (!*v)
+      break;
+
+    const char *name = v;
+    while (*v && *v != '=' && *v != ',' && *v != ' ' && *v != '\t')
+      v++;
+    size_t nlen = (size_t)(v - name);
+
+    const char *val = NULL;
+    size_t vlen = 0;
+    if (*v == '=')
+    {
+      val = ++v;
+      if (*v == '"')
+      {
+        v++;
+        while (*v && *v != '"')
+          v++;
+        if (*v == '"')
+          v++;
+      }
+      else
+      {
+        while (*v && *v != ',' && *v != ' ' && *v != '\t')
+          v++;
+      }
+      vlen = (size_t)(v - val);
+    }
+    while (*v && *v != ',')
+      v++;
+
+#define IS(d) (nlen == sizeof(d) - 1 && !strncasecmp(name, d, nlen))
+    if (IS("max-age") && val)
+      m->max_age = parse_delta(val, vlen);
+    else if (IS("s-maxage") && val)
+      m->s_maxage = parse_delta(val, vlen);
+    else if (IS("no-store"))
+      m->no_store = 1;
+    else if (IS("private"))
+      m->is_private = 1;
+    else if (IS("no-cache"))
+      m->no_cache = 1;
+    else if (IS("must-revalidate") || IS("proxy-revalidate"))
+      m->must_revalidate = 1;
+    else if (IS("stale-while-revalidate") && val)
+      m->stale_while_revalidate = parse_delta(val, vlen);
+    else if (IS("stale-if-error") && val)
+      m->stale_if_error = parse_delta(val, vlen);
+#undef IS
+  }
+}
+
+/* 헤더 값의 앞뒤 공백/CRLF를 잘라 dst에 복사 */
+static void copy_value(char *dst, size_t n, const char *v)
+{
+  size_t len = strcspn(v, "\r\n");
+
+  while (len > 0 && (v[len - 1] == ' ' || v[len - 1] == '\t'))
+    len--;
+  if (len >= n)
+    len = n - 1;
+  memcpy(dst, v, len);
+  dst[len] = '\0';
+}
+
+/*
+ * parse_vary(m, v)
+ *  - "Accept-Encoding, Accept-Language" → m->vary = "accept-encoding,accept-language"
+ *  - 여러 줄로 오면 이어 붙인다. "*" 이거나 HTTP_VARY_LEN을 넘으면 vary_star.
+ */
+static void parse_vary(http_meta_t *m, const char *v)
+{
+  size_t len = strlen(m->vary);
+
+  while (*v)
+  {
+    while (*v == ' ' || *v == '\t' || *v == ',')
+      v++;
+    if (!*v)
+      break;
+    size_t n = strcspn(v, " \t,");
+    if (n == 1 && *v == '*')
+      m->vary_star = 1;
+    else if (len + (len > 0) + n >= sizeof(m->vary))
+      m->vary_star = 1;
+    else
+    {
+      if (len > 0)
+        m->vary[len++] = ',';
+      for (size_t i = 0; i < n; i++)
+        m->vary[len++] = (char)tolower((unsigned char)v[i]);
+      m->vary[len] = '\0';
+    }
+    v += n;
+  }
+}
+
+/*
+ * http_parse_header(m, line)
+ *  - "Name: value\r\n" 한 줄을 보고, 캐시 판단에 쓰는 헤더면 m에 반영한다.
+ */
+void http_parse_header(http_meta_t *m, const char *line)
+{
+  const char *colon = strchr(line, ':');
+  char value[MAXLINE];
+
+  if (!colon)
+    return;
+  size_t nlen = (size_t)(colon - line);
+  const char *v = colon + 1;
+  while (*v == ' ' || *v == '\t')
+    v++;
+  copy_value(value, sizeof(value), v);
+
+#define IS(h) (nlen == sizeof(h) - 1 && !strncasecmp(line, h, nlen))
+  if (IS("Cache-Control"))
+    parse_cache_control(m, value);
+  else if (IS("Pragma"))
+  {
+    /* HTTP/1.0 원서버 호환: Cache-Control이 없을 때의 no-cache */
+    if (strcasestr(value, "no-cache"))
+      m->no_cache = 1;
+  }
+  else if (IS("Date"))
+    m->date = http_parse_date(value);
+  else if (IS("Expires"))
+  {
+    m->has_expires = 1;
+    m->expires = http_parse_date(value); /* 잘못된 값(예: "0")은 0 → 이미 만료 */
+  }
+  else if (IS("Age"))
+  {
+    long age = parse_delta(value, strlen(value));
+    m->age = age < 0 ? 0 : age;
+  }
+  else if (IS("Last-Modified"))
+  {
+    m->last_modified = http_parse_date(value);
+    copy_value(m->last_modified_str, sizeof(m->last_modified_str), value);
+  }
+  else if (IS("ETag"))
+    copy_value(m->etag, sizeof(m->etag), value);
+  else if (IS("Content-Length"))
+    m->content_length = parse_delta(value, strlen(value));
+  else if (IS("Set-Cookie"))
+    m->set_cookie = 1;
+  else if (IS("Transfer-Encoding"))
+  {
+    if (strcasestr(value, "chunked"))
+      m->chunked = 1;
+  }
+  else if (IS("Vary"))
+    parse_vary(m, value);
+#undef IS
+}
+
+/*
+ * http_read_response(rp, hdr, line, m)
+ *  - 응답의 상태줄과 헤더를 빈 줄까지 읽어 원문은 hdr에 모으고, m을 채운다.
+ *  - 상태줄이 HTTP 형식이 아니면 첫 줄만 hdr에 담고 m->status = 0 으로 돌아온다
+ *    (호출자는 나머지를 본문으로 취급).
+ *  - 반환: 원서버가 아무것도 보내지 않고 닫았으면 0, 아니면 1
+ */
+int http_read_response(rio_t *rp, dbuf_t *hdr, dbuf_t *line, http_meta_t *m)
+{
+  http_meta_init(m);
+  dbuf_reset(hdr);
+
+  if (dbuf_readline(rp, line) <= 0)
+    return 0;
+  dbuf_append(hdr, line->data, line->len);
+  if ((m->status = http_parse_status(line->data)) == 0)
+    return 1;
+
+  while (dbuf_readline(rp, line) > 0)
+  {
+    dbuf_append(hdr, line->data, line->len);
+    if (!strcmp(line->data, "\r\n"))
+      break;
+    http_parse_header(m, line->data);
+  }
+  return 1;
+}
+
+/*
+ * http_append_stored(dst, hdr, len)
+ *  - 원서버 응답 헤더 블록(hdr)을 캐시 저장용으로 dst에 덧붙인다.
+ *  - 응답할 때마다 프록시가 새로 붙이는 Age / X-Cache 줄은 빼고 저장한다
+ *    (히트 때 헤더 블록을 고치지 않고 그대로 보내기 위해).
+ */
+void http_append_stored(dbuf_t *dst, const char *hdr, size_t len)
+{
+  const char *p = hdr, *end = hdr + len;
+
+  while (p < end)
+  {
+    const char *nl = memchr(p, '\n', (size_t)(end - p));
+    size_t n = nl ? (size_t)(nl - p) + 1 : (size_t)(end - p);
+
+    if (strncasecmp(p, "Age:", 4) && strncasecmp(p, "X-Cache:", 8))
+      dbuf_append(dst, p, n);
+    p += n;
+  }
+}
+
+/*
+ * http_strip_header(hdr, name)
+ *  - 헤더 블록에서 name 헤더 줄을 모두 지운다(제자리에서).
+ */
+void http_strip_header(dbuf_t *hdr, const char *name)
+{
+  size_t nlen = strlen(name);
+  char *p = hdr->data, *end = hdr->data + hdr->len, *w = hdr->data;
+
+  while (p < end)
+  {
+    char *nl = memchr(p, '\n', (size_t)(end - p));
+    size_t n = nl ? (size_t)(nl - p) + 1 : (size_t)(end - p);
+
+    if (!(n > nlen && p[nlen] == ':' && !strncasecmp(p, name, nlen)))
+    {
+      memmove(w, p, n);
+      w += n;
+    }
+    p += n;
+  }
+  hdr->len = (size_t)(w - hdr->data);
+  hdr->data[hdr->len] = '\0';
+}
+
+/*
+ * http_find_header(hdrs, name, len)
+ *  - "Name: value\r\n" 줄들이 이어진 블록(hdrs, NUL 종료)에서 name 헤더의 첫 값을 찾는다.
+ *  - 반환: 값의 시작(앞뒤 공백 제외, 길이는 *len), 없으면 NULL
+ */
+const char *http_find_header(const char *hdrs, const char *name, size_t *len)
+{
+  size_t nlen = strlen(name);
+  const char *p = hdrs;
+
+  while (p && *p)
+  {
+    if (!strncasecmp(p, name, nlen) && p[nlen] == ':')
+    {
+      const char *v = p + nlen + 1;
+      size_t n;
+
+      while (*v == ' ' || *v == '\t')
+        v++;
+      n = strcspn(v, "\r\n");
+      while (n > 0 && (v[n - 1] == ' ' || v[n - 1] == '\t'))
+        n--;
+      *len = n;
+      return v;
+    }
+    if ((p = strchr(p, '\n')) != NULL)
+      p++;
+  }
+  return NULL;
+}
+
+/* 응답의 본문 경계 방식(GET 요청 기준) */
+http_framing_t http_framing(const http_meta_t *m)
+{
+  if ((m->status >= 100 && m->status < 200) || m->status == 204 || m->status == 304)
+    return HTTP_BODY_NONE;
+  if (m->chunked)
+    return HTTP_BODY_CHUNKED; /* Transfer-Encoding이 Content-Length보다 우선 */
+  if (m->content_length >= 0)
+    return HTTP_BODY_LENGTH;
+  return HTTP_BODY_CLOSE; /* 상태줄이 HTTP가 아닌 응답도 여기 */
+}
+
+void http_body_init(http_body_t *b, rio_t *rp, dbuf_t *line, const http_meta_t *m)
+{
+  memset(b, 0, sizeof(*b));
+  b->rp = rp;
+  b->line = line;
+  b->framing = http_framing(m);
+  b->remaining = b->framing == HTTP_BODY_LENGTH ? m->content_length : 0;
+  b->done = b->framing == HTTP_BODY_NONE ||
+            (b->framing == HTTP_BODY_LENGTH && b->remaining == 0);
+}
+
+/* 본문 중단 — 형식 오류나 조기 EOF */
+static void body_truncated(http_body_t *b)
+{
+  b->truncated = 1;
+  b->done = 1;
+}
+
+/*
+ * next_chunk(b)
+ *  - 앞 청크 뒤의 CRLF와 다음 청크 크기 줄을 읽는다.
+ *  - 크기 0(마지막 청크)이면 트레일러를 빈 줄까지 버리고 done.
+ *  - 반환: 계속 읽을 수 있으면 0, 끝/중단이면 -1
+ */
+static int next_chunk(http_body_t *b)
+{
+  char *end;
+  long size;
+
+  if (b->in_chunk && (dbuf_readline(b->rp, b->line) <= 0 || strcmp(b->line->data, "\r\n")))
+    goto bad;
+  if (dbuf_readline(b->rp, b->line) <= 0)
+    goto bad;
+  size = strtol(b->line->data, &end, 16); /* 청크 확장(";ext")은 무시 */
+  if (end == b->line->data || size < 0 || (*end != ';' && *end != '\r' && *end != '\n'))
+    goto bad;
+
+  if (size == 0)
+  {
+    do /* 트레일러 */
+    {
+      if (dbuf_readline(b->rp, b->line) <= 0)
+        goto bad;
+    } while (strcmp(b->line->data, "\r\n"));
+    b->done = 1;
+    return -1;
+  }
+  b->remaining = size;
+  b->in_chunk = 1;
+  return 0;
+
+bad:
+  body_truncated(b);
+  return -1;
+}
+
+/*
+ * http_body_next(b, slice)
+ *  - 다음 본문 조각을 *slice(RIO 버퍼 안)에 가리키고 길이를 돌려준다.
+ *  - 본문이 끝나면 0. 끝난 이유는 b->truncated로 구분한다
+ *    (0이면 프레이밍대로 온전히 받음).
+ */
+ssize_t http_body_next(http_body_t *b, const char **slice)
+{
+  rio_t *rp = b->rp;
+  ssize_t n;
+
+  while (!b->done)
+  {
+    if (b->framing == HTTP_BODY_CHUNKED && b->remaining == 0)
+    {
+      if (next_chunk(b) < 0)
+        break;
+      continue;
+    }
+
+    if ((n = conn_rio_fill(rp)) <= 0)
+    {
+      if (n == 0 && b->framing == HTTP_BODY_CLOSE)
+        b->done = 1; /* 연결 종료가 곧 본문 끝 */
+      else
+        body_truncated(b);
+      break;
+    }
+    if (b->framing != HTTP_BODY_CLOSE && n > b->remaining)
+      n = b->remaining;
+
+    *slice = rp->rio_bufptr;
+    rp->rio_bufptr += n;
+    rp->rio_cnt -= n;
+    b->total += n;
+    if (b->framing != HTTP_BODY_CLOSE)
+    {
+      b->remaining -= n;
+      if (b->framing == HTTP_BODY_LENGTH && b->remaining == 0)
+        b->done = 1;
+    }
+    return n;
+  }
+  return 0;
+}
@@ -0,0 +1,100 @@
+/*
+ * http.h — 원서버 응답 헤더 파싱(캐시 판단에 필요한 필드만)
+ *
+ * ✅ 파싱하는 헤더
+ *   - 상태줄의 상태 코드
+ *   - Cache-Control: max-age, s-maxage, no-store, private, no-cache, must-revalidate,
+ *                    stale-while-revalidate, stale-if-error
+ *   - Expires, Date, Age, Last-Modified, ETag, Content-Length, Transfer-Encoding,
+ *     Set-Cookie(있는지만)
+ *   - Vary: 헤더 이름 목록을 소문자 + 쉼표 구분으로 정규화("accept-encoding,accept-language")
+ *           "*" 면 vary_star (어떤 요청 헤더로도 재사용할 수 없는 응답)
+ *
+ * ✅ 본문 프레이밍 (RFC 9112 §6.3)
+ *   - http_body_t가 헤더 다음의 본문을 Content-Length / chunked / 연결 종료 중
+ *     하나로 경계 지어 조각(slice) 단위로 내준다.
+ *   - 조각은 RIO 버퍼 안을 가리킨다(복사 없음). 다음 호출 전까지만 유효.
+ *   - chunked는 청크 경계를 벗겨 낸 실제 본문만 내준다.
+ *   - 본문 끝을 EOF가 아니라 프레이밍으로 판단하므로, 끝나기 전에 연결이 끊기면
+ *     truncated로 알 수 있다.
+ */
+#ifndef __HTTP_H__
+#define __HTTP_H__
+
+#include "csapp.h"
+#include "conn.h"
+
+/* ETag / Last-Modified 원문을 담을 최대 길이 */
+#define HTTP_VALIDATOR_LEN 256
+
+/* 정규화한 Vary 이름 목록의 최대 길이(넘치면 vary_star와 같이 취급) */
+#define HTTP_VARY_LEN 128
+
+typedef struct
+{
+  int status; /* 상태 코드(파싱 실패 시 0) */
+
+  time_t date;          /* Date (없으면 0) */
+  time_t expires;       /* Expires (없으면 0) */
+  int has_expires;      /* Expires 헤더 존재 여부(잘못된 값이면 "이미 만료") */
+  time_t last_modified; /* Last-Modified (없으면 0) */
+  long age;             /* Age (없으면 0) */
+  long content_length;  /* Content-Length (없으면 -1) */
+  int chunked;          /* Transfer-Encoding: chunked */
+  int set_cookie;       /* Set-Cookie 헤더 존재 */
+  int vary_star;        /* Vary: * (또는 목록이 너무 김) */
+
+  /* Cache-Control (없는 지시자는 -1 / 0) */
+  long max_age;
+  long s_maxage;
+  int no_store;
+  int is_private;
+  int no_cache;
+  int must_revalidate;
+  long stale_while_revalidate; /* RFC 5861 */
+  long stale_if_error;
+
+  /* 검증자 원문(조건부 요청에 그대로 되돌려 보낸다) */
+  char etag[HTTP_VALIDATOR_LEN];
+  char last_modified_str[HTTP_VALIDATOR_LEN];
+
+  /* Vary 이름 목록(정규화, 없으면 빈 문자열) */
+  char vary[HTTP_VARY_LEN];
+} http_meta_t;
+
+/* 본문 경계 방식 */
+typedef enum
+{
+  HTTP_BODY_NONE,    /* 본문 없음(1xx/204/304) */
+  HTTP_BODY_LENGTH,  /* Content-Length */
+  HTTP_BODY_CHUNKED, /* Transfer-Encoding: chunked */
+  HTTP_BODY_CLOSE,   /* 원서버가 연결을 닫을 때까지 */
+} http_framing_t;
+
+typedef struct
+{
+  rio_t *rp;
+  dbuf_t *line;          /* 청크 크기 줄/트레일러 읽기용 */
+  http_framing_t framing;
+  long remaining;        /* LENGTH: 남은 본문, CHUNKED: 현재 청크의 남은 바이트 */
+  int in_chunk;          /* CHUNKED: 청크 데이터를 하나 이상 지났는지(뒤의 CRLF 처리) */
+  int done;              /* 본문 끝에 도달(또는 중단) */
+  int truncated;         /* 프레이밍이 끝나기 전에 연결이 끊기거나 형식이 깨짐 */
+  long total;            /* 지금까지 내준 본문 바이트 */
+} http_body_t;
+
+void http_meta_init(http_meta_t *m);
+int http_parse_status(const char *line);
+void http_parse_header(http_meta_t *m, const char *line);
+time_t http_parse_date(const char *s);
+void http_format_date(time_t t, char *buf, size_t n);
+int http_read_response(rio_t *rp, dbuf_t *hdr, dbuf_t *line, http_meta_t *m);
+void http_append_stored(dbuf_t *dst, const char *hdr, size_t len);
+void http_strip_header(dbuf_t *hdr, const char *name);
+const char *http_find_header(const char *hdrs, const char *name, size_t *len);
+
+http_framing_t http_framing(const http_meta_t *m);
+void http_body_init(http_body_t *b, rio_t *rp, dbuf_t *line, const http_meta_t *m);
+ssize_t http_body_next(http_body_t *b, const char **slice);
+
+#endif /* __HTTP_H__ */
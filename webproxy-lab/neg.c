@@ -0,0 +1,151 @@
+/*
+ * neg.c — 원서버 오류 네거티브 캐시 구현
+ */
+#include "neg.h"
+#include "stats.h"
+
+typedef struct neg_ent
+{
+  char *key;      /* "host:port" */
+  int err;        /* open_clientfd 반환값(-1 / -2) */
+  time_t expires;
+  struct neg_ent *next;
+} neg_ent_t;
+
+static neg_ent_t *buckets[NEG_BUCKETS];
+static int count;
+static pthread_mutex_t neg_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static long ttl_dns = NEG_TTL_DNS, ttl_connect = NEG_TTL_CONNECT, ttl_status = NEG_TTL_STATUS;
+
+/*
+ * neg_config(spec)
+ *  - "-N dns=30,connect=5,status=60" 형식(일부만 줘도 된다).
+ *  - 반환: 성공 0, 형식 오류 -1
+ */
+int neg_config(const char *spec)
+{
+  while (*spec)
+  {
+    size_t n = strcspn(spec, "=");
+    char *end;
+    long v;
+
+    if (spec[n] != '=')
+      return -1;
+    v = strtol(spec + n + 1, &end, 10);
+    if (end == spec + n + 1 || v < 0 || (*end && *end != ','))
+      return -1;
+    if (n == 3 && !strncmp(spec, "dns", 3))
+      ttl_dns = v;
+    else if (n == 7 && !strncmp(spec, "connect", 7))
+      ttl_connect = v;
+    else if (n == 6 && !strncmp(spec, "status", 6))
+      ttl_status = v;
+    else
+      return -1;
+    spec = *end ? end + 1 : end;
+  }
+  return 0;
+}
+
+/* 404 / 410 응답에 신선도 정보가 없을 때의 수명(cache.c가 쓴다) */
+long neg_status_ttl(void)
+{
+  return ttl_status;
+}
+
+static unsigned hash_key(const char *host, const char *port)
+{
+  unsigned h = 5381;
+
+  while (*host)
+    h = h * 33 + (unsigned char)tolower((unsigned char)*host++);
+  while (*port)
+    h = h * 33 + (unsigned char)*port++;
+  return h % NEG_BUCKETS;
+}
+
+/* 같은 host:port 인지("host:port" 문자열과 비교, host는 대소문자 무시) */
+static int same(const char *key, const char *host, const char *port)
+{
+  size_t hlen = strlen(host);
+
+  return !strncasecmp(key, host, hlen) && key[hlen] == ':' && !strcmp(key + hlen + 1, port);
+}
+
+/* neg_lock 보유 상태에서 체인의 만료 항목을 정리하고 찾는 항목의 링크를 돌려준다 */
+static neg_ent_t **find_locked(unsigned h, const char *host, const char *port, time_t now)
+{
+  neg_ent_t **pp = &buckets[h];
+
+  while (*pp)
+  {
+    neg_ent_t *e = *pp;
+
+    if (e->expires <= now)
+    {
+      *pp = e->next;
+      free(e->key);
+      free(e);
+      count--;
+      continue;
+    }
+    if (same(e->key, host, port))
+      return pp;
+    pp = &e->next;
+  }
+  return pp;
+}
+
+/*
+ * neg_lookup(host, port)
+ *  - 최근에 실패한 host:port 이면 그때의 open_clientfd 반환값(-1 / -2), 아니면 0.
+ */
+int neg_lookup(const char *host, const char *port)
+{
+  unsigned h = hash_key(host, port);
+  neg_ent_t **pp;
+  int err = 0;
+
+  pthread_mutex_lock(&neg_lock);
+  if (buckets[h] && *(pp = find_locked(h, host, port, time(NULL))))
+    err = (*pp)->err;
+  pthread_mutex_unlock(&neg_lock);
+  if (err)
+    STAT_INC(neg_hit);
+  return err;
+}
+
+/*
+ * neg_store(host, port, err)
+ *  - open_clientfd 실패(err = -1 연결, -2 이름 해석)를 등급별 TTL 동안 기억한다.
+ */
+void neg_store(const char *host, const char *port, int err)
+{
+  long ttl = err == -2 ? ttl_dns : ttl_connect;
+  unsigned h = hash_key(host, port);
+  time_t now = time(NULL);
+  neg_ent_t **pp, *e;
+
+  if (ttl <= 0)
+    return;
+  pthread_mutex_lock(&neg_lock);
+  if ((e = *(pp = find_locked(h, host, port, now))) == NULL)
+  {
+    if (count >= NEG_MAX)
+    {
+      pthread_mutex_unlock(&neg_lock);
+      return;
+    }
+    e = Calloc(1, sizeof(*e));
+    e->key = Malloc(strlen(host) + strlen(port) + 2);
+    sprintf(e->key, "%s:%s", host, port);
+    *pp = e;
+    count++;
+  }
+  e->err = err;
+  e->expires = now + ttl;
+  pthread_mutex_unlock(&neg_lock);
+  STAT_INC(neg_stored);
+}
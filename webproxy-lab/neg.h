@@ -0,0 +1,37 @@
+/*
+ * neg.h — 원서버 오류 네거티브 캐시
+ *
+ * ✅ 왜?
+ *   - 원서버가 죽어 있으면 같은 호스트로 가는 요청마다 open_clientfd()가 DNS 조회와
+ *     connect 타임아웃을 다시 겪고 나서야 502를 돌려준다(그동안 스레드 하나가 묶인다).
+ *   - 실패를 짧게 기억해 두고, 그 사이 같은 host:port 요청은 메모리에서 바로 실패시킨다.
+ *
+ * ✅ 오류 등급과 TTL (-N 으로 등급별 변경, 0이면 그 등급은 기억하지 않음)
+ *   - dns:     이름 해석 실패(open_clientfd가 -2)          기본 NEG_TTL_DNS초
+ *   - connect: 연결 실패(open_clientfd가 -1)              기본 NEG_TTL_CONNECT초
+ *   - status:  404 / 410 응답 — 이 테이블이 아니라 메모리 캐시에 본문째 들어간다.
+ *              응답에 신선도 정보(max-age/Expires)가 없을 때의 수명으로 쓴다.
+ *              기본 NEG_TTL_STATUS초. 0이면 명시적 수명이 없는 404 / 410은 저장하지 않는다.
+ *
+ * ✅ 구조
+ *   - "host:port" → (오류 코드, 만료 시각) 해시 테이블 하나 + mutex.
+ *     만료된 항목은 조회/저장 때 그 체인에서 정리한다. NEG_MAX개가 차면 더 넣지 않는다.
+ */
+#ifndef __NEG_H__
+#define __NEG_H__
+
+#include "csapp.h"
+
+#define NEG_TTL_DNS 30
+#define NEG_TTL_CONNECT 5
+#define NEG_TTL_STATUS 60
+
+#define NEG_BUCKETS 64
+#define NEG_MAX 1024
+
+int neg_config(const char *spec);
+long neg_status_ttl(void);
+int neg_lookup(const char *host, const char *port);
+void neg_store(const char *host, const char *port, int err);
+
+#endif /* __NEG_H__ */
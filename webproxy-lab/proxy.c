@@ -15,8 +15,33 @@
  *       Proxy-Connection: close
  *     → 브라우저가 보낸 동일 키 헤더는 무시하고, 프록시 값으로 덮어쓴다.
  *   - 그 외 헤더는 그대로 전달(필요 시 필터링 가능하지만, 기본은 그대로 pass-through).
- *   - 응답은 특별히 손대지 않고 **EOF까지 바이트 스트림**으로 중계한다
- *     (HTTP/1.0 close 전략. chunked/Content-Length 여부와 무관).
+ *   - 응답 본문의 끝은 EOF가 아니라 프레이밍으로 판단한다(http.c의 http_body_t):
+ *       Content-Length 가 있으면 그 길이만큼,
+ *       chunked 면 청크를 풀어 마지막 0 청크까지(경계는 벗기고 Transfer-Encoding 줄은 뺀다),
+ *       둘 다 없으면 원서버가 연결을 닫을 때까지.
+ *     클라이언트 쪽은 HTTP/1.0 close 전략 그대로 — 본문을 보낸 뒤 연결을 닫는다.
+ *     프레이밍보다 일찍 끊긴 응답은 캐시하지 않는다.
+ *
+ * ✅ 캐시 (cache.c)
+ *   - 저장 가능한 200 응답(≤100KiB)을 URL 키로 보관한다.
+ *   - Cache-Control / Expires / Date / Last-Modified 로 신선도 수명을 계산하고,
+ *     stale 엔트리는 If-None-Match / If-Modified-Since 로 재검증한다.
+ *     304가 오면 본문을 다시 받지 않고 메타데이터만 갱신해 캐시 본문을 보낸다.
+ *   - stale-while-revalidate 창 안이면 만료 본문을 즉시 보내고 갱신은
+ *     refresh.c 의 전용 스레드 풀이 맡는다. stale-if-error 창 안이면
+ *     원서버 오류 대신 만료 본문을 보낸다.
+ *   - -d <dir> 를 주면 메모리에서 밀려난 객체를 디스크 세그먼트(disk.c)에 내리고,
+ *     메모리 미스 시 디스크에서 sendfile로 바로 응답한다.
+ *   - 더 이상 쓸 수 없는 만료 엔트리는 janitor 스레드가 만료 힙 순서대로 정리한다.
+ *   - -m <name> 을 주면 같은 호스트의 proxy 프로세스들이 공유 메모리 세그먼트
+ *     하나를 2차 캐시로 함께 쓴다(shm.c). 로컬 미스는 공유 캐시부터 본다.
+ *   - -s <file> 을 주면 SIGTERM(그리고 -S <초> 주기)마다 메모리 캐시를 스냅샷으로
+ *     저장하고, 다음 시작 때 mmap으로 적재해 warm 상태로 시작한다(snapshot.c).
+ *   - 원서버 DNS/연결 실패는 host:port 단위로 잠깐 기억해 같은 원서버로 가는 요청을
+ *     바로 502로 끝낸다(neg.c). 404/410 응답도 캐시한다. 등급별 TTL은 -N 으로 정한다.
+ *   - Range 요청은 캐시에 전체 객체가 있으면 거기서 잘라 206으로 답한다(range.c).
+ *     -r 을 주면 Range 미스 때 전체 객체를 받아 캐시해 두고 다음부터 히트로 답한다.
+ *   - 카운터(stats.c)는 SIGUSR1을 받으면 출력한다.
  *
 
  * ⚠️ 자주 틀리는 포인트
@@ -28,29 +53,49 @@
 
 #include <stdio.h>
 
-/* (Part III에서 사용할 상수 — 현재 파일에서는 사용하지 않지만, 핸드아웃 권장) */
-#define MAX_CACHE_SIZE 1049000
-#define MAX_OBJECT_SIZE 102400
-
 /* 과제에서 제공하는 User-Agent 한 줄 (꼭 그대로, 줄 끝 \r\n 포함) */
 static const char *user_agent_hdr =
     "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:10.0.3) Gecko/20120305 "
     "Firefox/10.0.3\r\n";
 
 #include "csapp.h"
+#include "conn.h"
+#include "cache.h"
+#include "refresh.h"
+#include "disk.h"
+#include "stats.h"
+#include "snapshot.h"
+#include "shm.h"
+#include "relay.h"
+#include "range.h"
+#include "neg.h"
+
+#define USAGE "usage: %s [-r] [-N dns=S,connect=S,status=S] [-d cachedir] [-m shmname [-M MiB]] [-s snapshot [-S secs]] <port>\n"
+
+static const char *snapshot_path; /* -s: 스냅샷 파일(없으면 NULL) */
+static int range_whole;           /* -r: Range 미스면 Range를 빼고 전체를 받아 캐시 */
 
 /* ---- 프로토타입(정적 내부 함수) ----
  * 외부 노출을 막고 파일 내부에서만 사용할 함수들은 static으로 선언합니다.
  */
-static void doit(int fd);
-static void read_requesthdrs(rio_t *rp, char *host_header, char *other_header);
-static void parse_uri(const char *uri, char *hostname, char *port, char *path);
-static void reassemble(char *req, const char *path, const char *hostname,
-                       const char *port, const char *other_header);
-static void forward_response(int servedf, int fd);
+static void doit(conn_t *c);
+static int parse_requestline(conn_t *c);
+static void read_requesthdrs(conn_t *c);
+static void skip_requesthdrs(conn_t *c);
+static int is_range_header(const dbuf_t *line);
+static void parse_uri(conn_t *c);
+static void make_cache_key(conn_t *c);
+static void reassemble(conn_t *c, const cache_meta_t *validators);
+static void forward_response(conn_t *c, int servedf, cache_entry_t *stale,
+                             const cache_meta_t *stale_meta, time_t request_time);
+static void serve_cached(conn_t *c, cache_entry_t *e, const cache_meta_t *meta,
+                         const char *xcache);
+static size_t hit_headers(char *buf, size_t n, const cache_meta_t *meta, const char *xcache);
+static int serve_disk(conn_t *c, time_t now);
 static void clienterror(int fd, const char *cause,
                         const char *errnum, const char *shortmsg, const char *longmsg);
 static void *thread(void *vargp);
+static void *signal_thread(void *vargp);
 
 /* === 교체된 main === */
 int main(int argc, char **argv)
@@ -58,18 +103,89 @@ int main(int argc, char **argv)
   int listenfd;
   socklen_t clientlen;
   struct sockaddr_storage clientaddr;
-  char hostname[MAXLINE], port[MAXLINE];
-
-  if (argc != 2)
+  char hostname[NI_MAXHOST], port[NI_MAXSERV];
+  pthread_attr_t attr;
+  pthread_t tid;
+  sigset_t mask;
+  const char *disk_dir = NULL, *shm_name = NULL;
+  int opt, snapshot_interval = 0, shm_mb = SHM_DEFAULT_MB;
+
+  /* 옵션: -d <dir> 디스크 2차 캐시 디렉터리
+   *       -m <name> 공유 메모리 캐시 이름, -M <MiB> 새로 만들 때의 크기
+   *       -s <file> 캐시 스냅샷 파일, -S <초> 주기 저장
+   *       -r        Range 미스 때 전체 객체를 받아 캐시
+   *       -N <spec> 네거티브 캐시 등급별 TTL(초) */
+  while ((opt = getopt(argc, argv, "rN:d:m:M:s:S:")) != -1)
+  {
+    switch (opt)
+    {
+    case 'N':
+      if (neg_config(optarg) < 0)
+      {
+        fprintf(stderr, USAGE, argv[0]);
+        exit(1);
+      }
+      break;
+    case 'r':
+      range_whole = 1;
+      break;
+    case 'd':
+      disk_dir = optarg;
+      break;
+    case 'm':
+      shm_name = optarg;
+      break;
+    case 'M':
+      shm_mb = atoi(optarg);
+      break;
+    case 's':
+      snapshot_path = optarg;
+      break;
+    case 'S':
+      snapshot_interval = atoi(optarg);
+      break;
+    default:
+      fprintf(stderr, USAGE, argv[0]);
+      exit(1);
+    }
+  }
+  if (optind != argc - 1 || (snapshot_interval > 0 && !snapshot_path))
   {
-    fprintf(stderr, "usage: %s <port>\n", argv[0]);
+    fprintf(stderr, USAGE, argv[0]);
     exit(1);
   }
 
   /* 클라이언트가 중간에 끊어도 프로세스가 죽지 않도록 */
   Signal(SIGPIPE, SIG_IGN);
 
-  listenfd = Open_listenfd(argv[1]);
+  /* SIGUSR1/SIGTERM은 모든 스레드에서 막고 signal_thread가 sigwait으로 받는다
+   * (핸들러 대신 일반 스레드 문맥에서 처리하므로 printf/락 사용 가능) */
+  Sigemptyset(&mask);
+  Sigaddset(&mask, SIGUSR1);
+  Sigaddset(&mask, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &mask, NULL);
+  Pthread_create(&tid, NULL, signal_thread, NULL);
+
+  cache_init();
+  if (disk_dir)
+    disk_init(disk_dir);
+  if (shm_name)
+    shm_init(shm_name, (size_t)shm_mb << 20);
+  if (snapshot_path)
+  {
+    snapshot_load(snapshot_path);
+    if (snapshot_interval > 0)
+      snapshot_start(snapshot_path, snapshot_interval);
+  }
+  cache_janitor_start();
+  refresh_init();
+
+  listenfd = Open_listenfd(argv[optind]);
+
+  /* 큰 버퍼는 모두 conn_t(힙)에 있으므로 스레드 스택은 작게, 처음부터 detached로 */
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, CONN_STACK_SIZE);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
 
   while (1)
   {
@@ -79,57 +195,81 @@ int main(int argc, char **argv)
     int connfd = Accept(listenfd, (SA *)&clientaddr, &clientlen);
 
     /* 로깅(선택) */
-    Getnameinfo((SA *)&clientaddr, clientlen, hostname, MAXLINE, port, MAXLINE, 0);
+    Getnameinfo((SA *)&clientaddr, clientlen, hostname, sizeof(hostname), port, sizeof(port), 0);
     printf("Accepted connection from (%s, %s)\n", hostname, port);
 
-    /* 스레드에 안전하게 넘기기 위해 동적 메모리에 복사 */
-    int *connfdp = Malloc(sizeof(int));
-    *connfdp = connfd;
+    /* 연결 상태 객체를 풀에서 꺼내 스레드에 넘긴다 */
+    conn_t *c = conn_get(connfd);
 
-    pthread_t tid;
-    Pthread_create(&tid, NULL, thread, connfdp);
-    /* 부모는 connfd를 닫지 않습니다. thread()가 doit(connfd) 후 Close(connfd) 합니다. */
+    Pthread_create(&tid, &attr, thread, c);
+    /* 부모는 connfd를 닫지 않습니다. thread()가 doit(c) 후 Close + conn_put 합니다. */
   }
 }
 
 void *thread(void *vargp)
 {
-  int connfd = *((int *)vargp);
-  free(vargp);
-  pthread_detach(pthread_self());
+  conn_t *c = vargp;
+  int connfd = c->fd;
 
-  doit(connfd);
+  doit(c);
+  conn_put(c);
   Close(connfd);
   return NULL;
 }
 
+/* SIGUSR1 → 카운터 출력, SIGTERM → (-s 이면 스냅샷 저장 후) 종료 */
+static void *signal_thread(void *vargp)
+{
+  sigset_t mask;
+  int sig;
+
+  Pthread_detach(pthread_self());
+  Sigemptyset(&mask);
+  Sigaddset(&mask, SIGUSR1);
+  Sigaddset(&mask, SIGTERM);
+  while (1)
+  {
+    if (sigwait(&mask, &sig) != 0)
+      continue;
+    if (sig == SIGUSR1)
+      stats_dump(stdout);
+    else if (sig == SIGTERM)
+    {
+      if (snapshot_path)
+        snapshot_save(snapshot_path);
+      fflush(stdout);
+      exit(0);
+    }
+  }
+  return NULL;
+}
+
 /*
- * doit(fd)
+ * doit(c)
  *  - 단일 클라이언트 연결을 처리합니다.
- *  - 요청 라인을 읽어 메서드/URI/버전을 파싱하고, 헤더를 읽어
- *    재작성 대상 헤더를 제외한 나머지를 수집합니다.
- *  - URI에서 host/port/path를 뽑아 원서버에 연결한 뒤,
+ *  - 요청 라인을 읽어 메서드/URI/버전을 파싱하고, URI에서 host/port/path를 뽑아
+ *    헤더를 읽기 전에 캐시부터 조회합니다. fresh 히트면 나머지 헤더는 훑기만 하고
+ *    원서버에 가지 않고 바로 응답합니다.
+ *  - 그 밖에는 헤더를 읽어 재작성 대상 헤더를 제외한 나머지를 수집합니다.
+ *  - 미스(또는 stale)면 원서버에 연결한 뒤,
  *    HTTP/1.0 규칙에 맞춘 새로운 요청을 만들어 전송합니다.
- *  - 원서버 응답을 EOF까지 그대로 클라이언트에 중계합니다.
+ *    stale 엔트리는 검증자를 붙인 조건부 요청으로 재검증합니다.
+ *    (SWR 창 안이면 만료 본문을 즉시 보내고 재검증은 백그라운드로)
+ *  - 원서버 응답을 본문 프레이밍이 끝날 때까지 클라이언트에 중계합니다.
+ *  - 모든 버퍼는 c(힙, 풀에서 할당) 안에 있으므로 스택은 거의 쓰지 않습니다.
  */
-static void doit(int fd)
+static void doit(conn_t *c)
 {
-  /* 입력 버퍼 및 파싱용 버퍼들 */
-  char buf[MAXLINE], method[MAXLINE], uri[MAXLINE], version[MAXLINE];
-  char host_header[MAXLINE], other_header[MAXLINE];     /* Host 한 줄과 그 외 헤더 모음 */
-  char hostname[MAXLINE], port[MAXLINE], path[MAXLINE]; /* URI 분해 결과 */
-  char request_buf[MAXBUF * 2];                         /* 원서버로 보낼 최종 요청 헤더(여유롭게 2*MAXBUF) */
-  rio_t rio;                                            /* Robust I/O(라인/바이트 단위 안전 I/O) */
+  int fd = c->fd;
 
   /* 1) 요청 라인 읽기 */
-  Rio_readinitb(&rio, fd);
-  if (Rio_readlineb(&rio, buf, MAXLINE) <= 0)
+  if (dbuf_readline(&c->rio, &c->line) <= 0)
     return; /* EOF — 클라이언트가 연결만 열고 바로 끊었을 수 있음 */
 
-  printf("Request headers:\n%s", buf); /* 디버깅용 */
+  printf("Request headers:\n%s", c->line.data); /* 디버깅용 */
 
   /* "METHOD URI VERSION" 파싱 (예: "GET http://h/p HTTP/1.1") */
-  if (sscanf(buf, "%s %s %s", method, uri, version) != 3)
+  if (parse_requestline(c) < 0)
   {
     clienterror(fd, "request line", "400", "Bad Request",
                 "Malformed request line");
@@ -137,103 +277,252 @@ static void doit(int fd)
   }
 
   /* 이 버전은 GET만 지원 (핸드아웃 Part I 기본) */
-  if (strcasecmp(method, "GET") != 0)
+  if (strcasecmp(c->method.data, "GET") != 0)
   {
-    clienterror(fd, method, "501", "Not Implemented",
+    clienterror(fd, c->method.data, "501", "Not Implemented",
                 "This proxy only implements GET");
     return;
   }
 
-  /* 2) 헤더 읽기 — 프록시가 덮어쓸 4개(User-Agent/Connection/Proxy-Connection/Host) 제외하고 수집 */
-  read_requesthdrs(&rio, host_header, other_header);
-
-  /* 3) URI 파싱 — "http://host[:port]/path" 에서 host/port/path 추출
+  /* 2) URI 파싱 — "http://host[:port]/path" 에서 host/port/path 추출
    *    - 포트가 없으면 기본 80
    *    - path가 없으면 "/"
    */
-  parse_uri(uri, hostname, port, path);
+  parse_uri(c);
+  make_cache_key(c);
+
+  /* 3) 빠른 경로 — 요청 라인만으로 캐시부터 본다
+   *    - fresh 히트면 나머지 헤더는 복사/분류하지 않고 빈 줄까지 훑기만 한 뒤
+   *      바로 응답을 보낸다(히트 응답은 요청 헤더에 따라 달라지지 않는다).
+   *    - Vary가 붙은 응답은 요청 헤더가 있어야 고를 수 있으므로 여기서는 찾지 않는다.
+   */
+  cache_meta_t meta;
+  time_t now = time(NULL);
+  cache_entry_t *e = cache_lookup(c->key.data, NULL, &meta);
+  if (e && cache_is_fresh(&meta, now))
+  {
+    skip_requesthdrs(c);
+    STAT_INC(cache_hit);
+    STAT_INC(fast_hit);
+    serve_cached(c, e, &meta, "HIT");
+    cache_release(e);
+    return;
+  }
+
+  /* 4) 헤더 읽기 — 프록시가 덮어쓸 4개(User-Agent/Connection/Proxy-Connection/Host) 제외하고 수집 */
+  read_requesthdrs(c);
+
+  /* 5) 나머지 캐시 경로
+   *    - Vary 변형: 요청 헤더로 2차 키를 맞춰 다시 찾는다
+   *    - 로컬 미스: 공유 캐시 → 디스크 캐시 순서로 본다
+   *    - stale + SWR 창 안: 만료 본문을 바로 보내고, 재검증은 갱신 풀에 맡긴다
+   *    - 그 밖의 stale: 검증자(ETag/Last-Modified)가 있으면 조건부 요청으로 재검증,
+   *                     없으면 미스와 똑같이 전체를 다시 받는다
+   */
+  if (!e)
+    e = cache_lookup(c->key.data, c->other_header.data, &meta);
+  if (!e && shm_fetch(c->key.data)) /* 다른 프로세스가 받아 둔 객체 */
+    e = cache_lookup(c->key.data, c->other_header.data, &meta);
+  if (!e)
+  {
+    if (serve_disk(c, now))
+      return;
+    STAT_INC(cache_miss);
+  }
+  else if (cache_is_fresh(&meta, now))
+  {
+    STAT_INC(cache_hit);
+    serve_cached(c, e, &meta, "HIT");
+    cache_release(e);
+    return;
+  }
+  else if (cache_can_serve_stale(&meta, now, meta.swr))
+  {
+    STAT_INC(stale_while_revalidate);
+    reassemble(c, &meta);
+    refresh_submit(e, &meta, e->key, c->hostname.data, c->port.data,
+                   c->req.data, c->req.len);
+    serve_cached(c, e, &meta, "STALE");
+    cache_release(e);
+    return;
+  }
 
-  /* 4) 원서버 연결 */
-  int servedf = Open_clientfd(hostname, port);
+  /* 6) 원서버 연결
+   *    - 실패해도 프로세스가 죽지 않도록 소문자 open_clientfd 사용
+   *    - 최근에 DNS/연결이 실패한 원서버면 다시 시도하지 않는다(네거티브 캐시)
+   *    - stale-if-error 창 안이면 502 대신 만료 본문
+   */
+  int servedf = neg_lookup(c->hostname.data, c->port.data);
+  if (servedf == 0 && (servedf = open_clientfd(c->hostname.data, c->port.data)) < 0)
+    neg_store(c->hostname.data, c->port.data, servedf);
   if (servedf < 0)
   {
+    if (e && cache_can_serve_stale(&meta, time(NULL), meta.sie))
+    {
+      STAT_INC(stale_if_error);
+      serve_cached(c, e, &meta, "STALE");
+      cache_release(e);
+      return;
+    }
     /* 원서버 접속 실패 → 502 반환 */
-    clienterror(fd, hostname, "502", "Bad Gateway",
-                "Failed to connect to origin");
+    cache_release(e);
+    clienterror(fd, c->hostname.data, "502", "Bad Gateway",
+                servedf == -2 ? "Failed to resolve origin" : "Failed to connect to origin");
     return;
   }
 
-  /* 5) 원서버로 보낼 요청 헤더 재작성/조립
+  /* 7) 원서버로 보낼 요청 헤더 재작성/조립
    *   - 요청 라인: "GET <path> HTTP/1.0\r\n"
    *   - Host: (포트가 80이 아니면 "host:port")
    *   - User-Agent: (과제 지정 문자열)
    *   - Connection: close
    *   - Proxy-Connection: close
    *   - 기타 헤더(other_header): 원본에서 수집한 것을 그대로 이어붙임
+   *   - 재검증이면 If-None-Match / If-Modified-Since (캐시의 검증자)
    *   - 마지막에 빈 줄("\r\n")
    */
-  reassemble(request_buf, path, hostname, port, other_header);
+  reassemble(c, e ? &meta : NULL);
 
-  /* 6) 원서버로 요청 전송 */
-  Rio_writen(servedf, request_buf, strlen(request_buf));
+  /* 8) 원서버로 요청 전송 (요청 시각은 Age 계산에 쓰인다) */
+  time_t request_time = time(NULL);
+  Rio_writen(servedf, c->req.data, c->req.len);
 
-  /* 7) 원서버 응답을 EOF까지 그대로 클라이언트에 중계
-   *    - HTTP/1.0 close 전략: Content-Length 유무/Transfer-Encoding 상관없이
-   *      소켓이 닫힐 때까지 바이트 스트리밍
+  /* 9) 원서버 응답을 클라이언트에 중계
+   *    - 본문 끝은 Content-Length / chunked / 연결 종료 중 응답의 프레이밍으로 판단
+   *    - 저장 가능한 응답이면 중계하면서 캐시에도 넣는다
+   *    - 재검증 중 304를 받으면 캐시 본문으로 응답
    */
-  forward_response(servedf, fd);
+  forward_response(c, servedf, e, &meta, request_time);
+  cache_release(e);
 
-  /* 8) 원서버 소켓 정리 (FD 누수 방지) */
+  /* 10) 원서버 소켓 정리 (FD 누수 방지) */
   Close(servedf);
 }
 
 /*
- * read_requesthdrs(rp, host_header, other_header)
+ * parse_requestline(c)
+ *  - c->line 의 "METHOD URI VERSION" 을 공백 기준으로 잘라
+ *    c->method / c->uri / c->version 에 담는다(sscanf("%s %s %s")와 동일한 규칙).
+ *  - 토큰이 3개 미만이면 -1.
+ */
+static int parse_requestline(conn_t *c)
+{
+  dbuf_t *out[] = {&c->method, &c->uri, &c->version};
+  const char *p = c->line.data;
+
+  for (int i = 0; i < 3; i++)
+  {
+    while (*p && isspace((unsigned char)*p))
+      p++;
+    const char *start = p;
+    while (*p && !isspace((unsigned char)*p))
+      p++;
+    if (p == start)
+      return -1;
+    dbuf_set(out[i], start, (size_t)(p - start));
+  }
+  return 0;
+}
+
+/*
+ * read_requesthdrs(c)
  *  - 클라이언트가 보낸 요청 헤더를 한 줄씩 읽는다.
  *  - Proxy가 덮어쓸 헤더들(User-Agent/Connection/Proxy-Connection/Host)은
- *    여기서 무시하거나 따로 저장하고, 나머지 헤더는 other_header 버퍼에 누적.
+ *    여기서 무시하거나 따로 저장하고, 나머지 헤더는 c->other_header 에 누적.
+ *  - 조건부 헤더(If-None-Match/If-Modified-Since)는 c->cond_header 에 따로 모은다.
+ *    캐시 재검증 때는 클라이언트 것 대신 캐시의 검증자를 보내야 하기 때문.
+ *  - Range / If-Range 는 c->range_header 에 따로 모은다(캐시 히트면 프록시가 답한다).
  *  - 헤더 종료("\r\n")를 만나면 리턴.
- *
- * ⚠️ 버퍼 안전성
- *  - other_header는 MAXLINE 크기이므로, 헤더가 아주 많을 경우 일부는 잘릴 수 있음.
- *    (과제 기본 테스트에는 충분. 더 안전히 하려면 동적 버퍼를 쓸 수 있음)
+ *  - other_header는 증가형 버퍼라 헤더가 많아도 잘리지 않는다.
  */
-static void read_requesthdrs(rio_t *rp, char *host_header, char *other_header)
+static void read_requesthdrs(conn_t *c)
 {
-  char buf[MAXLINE];
-  host_header[0] = '\0';
-  other_header[0] = '\0';
+  dbuf_t *line = &c->line;
+
+  dbuf_reset(&c->host_header);
+  dbuf_reset(&c->other_header);
+  dbuf_reset(&c->cond_header);
+  dbuf_reset(&c->range_header);
 
-  while (Rio_readlineb(rp, buf, MAXLINE) > 0 && strcmp(buf, "\r\n"))
+  while (dbuf_readline(&c->rio, line) > 0 && strcmp(line->data, "\r\n"))
   {
-    if (!strncasecmp(buf, "Host:", 5))
+    if (!strncasecmp(line->data, "Host:", 5))
     {
       /* Host 헤더는 유지(없으면 나중에 추가), 여기선 가장 최근 걸 보관 */
-      strncpy(host_header, buf, MAXLINE - 1);
-      host_header[MAXLINE - 1] = '\0';
+      dbuf_set(&c->host_header, line->data, line->len);
     }
-    else if (!strncasecmp(buf, "User-Agent:", 11) ||
-             !strncasecmp(buf, "Connection:", 11) ||
-             !strncasecmp(buf, "Proxy-Connection:", 17))
+    else if (!strncasecmp(line->data, "User-Agent:", 11) ||
+             !strncasecmp(line->data, "Connection:", 11) ||
+             !strncasecmp(line->data, "Proxy-Connection:", 17))
     {
       /* 이 3개는 프록시가 고정 값으로 덮어쓸 예정이므로 무시 */
       continue;
     }
+    else if (!strncasecmp(line->data, "If-None-Match:", 14) ||
+             !strncasecmp(line->data, "If-Modified-Since:", 18))
+    {
+      dbuf_append(&c->cond_header, line->data, line->len);
+    }
+    else if (is_range_header(line))
+    {
+      /* 캐시 히트면 여기서 잘라 주고, 미스면 reassemble이 원서버로 넘긴다 */
+      dbuf_append(&c->range_header, line->data, line->len);
+    }
     else
     {
       /* 나머지 헤더는 그대로 other_header에 이어붙임 */
-      size_t cur = strlen(other_header), add = strlen(buf);
-      if (cur + add < MAXLINE - 1)
-      {
-        memcpy(other_header + cur, buf, add + 1); /* '\0' 포함 복사 */
-      }
-      /* 넘치면 조용히 버림(실무라면 동적 확장/경고 로깅 권장) */
+      dbuf_append(&c->other_header, line->data, line->len);
     }
   }
 }
 
+/* Range: 또는 If-Range: 줄인지 */
+static int is_range_header(const dbuf_t *line)
+{
+  return !strncasecmp(line->data, "Range:", 6) || !strncasecmp(line->data, "If-Range:", 9);
+}
+
 /*
- * parse_uri(uri, hostname, port, path)
+ * skip_requesthdrs(c)
+ *  - 빠른 경로(캐시 히트)용: 헤더 블록 끝(빈 줄)까지 RIO 버퍼를 훑어 버린다.
+ *  - 줄 단위로 dbuf에 복사하거나 헤더 이름을 비교하지 않는다.
+ *    예외: 'R' / 'I' 로 시작하는 줄만 통째로 읽어 Range / If-Range 인지 본다.
+ */
+static void skip_requesthdrs(conn_t *c)
+{
+  rio_t *rp = &c->rio;
+  size_t line_len = 0;
+  char first = 0;
+
+  dbuf_reset(&c->range_header);
+  while (conn_rio_fill(rp) > 0)
+  {
+    if (line_len == 0 && ((*rp->rio_bufptr | 0x20) == 'r' || (*rp->rio_bufptr | 0x20) == 'i'))
+    {
+      if (dbuf_readline(rp, &c->line) <= 0)
+        return;
+      if (is_range_header(&c->line))
+        dbuf_append(&c->range_header, c->line.data, c->line.len);
+      continue;
+    }
+    char *nl = memchr(rp->rio_bufptr, '\n', (size_t)rp->rio_cnt);
+    size_t n = nl ? (size_t)(nl - rp->rio_bufptr) + 1 : (size_t)rp->rio_cnt;
+
+    if (line_len == 0)
+      first = *rp->rio_bufptr;
+    line_len += n;
+    rp->rio_bufptr += n;
+    rp->rio_cnt -= n;
+    if (!nl)
+      continue;
+    if (line_len == 1 || (line_len == 2 && first == '\r'))
+      return; /* "\r\n" 또는 "\n" — 헤더 끝 */
+    line_len = 0;
+  }
+}
+
+/*
+ * parse_uri(c)
  *  - URI가 "http://host[:port]/path" 형태라고 가정하고 분해한다.
  *  - 스킴(http://)은 있으면 건너뛰고, 첫 '/' 전까지를 host[:port], 이후를 path로 본다.
  *  - 포트가 없으면 "80", path가 없으면 "/".
@@ -245,9 +534,9 @@ static void read_requesthdrs(rio_t *rp, char *host_header, char *other_header)
  *
  * ⚠️ 프록시 프런트엔드(브라우저)는 보통 "절대URI"를 보냅니다.
  */
-static void parse_uri(const char *uri, char *hostname, char *port, char *path)
+static void parse_uri(conn_t *c)
 {
-  const char *u = uri;
+  const char *u = c->uri.data;
 
   /* 스킴 스킵 */
   if (!strncasecmp(u, "http://", 7))
@@ -256,95 +545,315 @@ static void parse_uri(const char *uri, char *hostname, char *port, char *path)
   /* 첫 슬래시로 path 경계 결정 */
   const char *slash = strchr(u, '/');
   if (slash)
-  {
-    strcpy(path, slash);
-  }
+    dbuf_set(&c->path, slash, strlen(slash));
   else
-  {
-    strcpy(path, "/");
-  }
+    dbuf_set(&c->path, "/", 1);
 
-  /* host[:port] 추출 */
-  char hostport[MAXLINE];
+  /* host[:port] 추출 — 포트가 명시됐는지 체크 */
   size_t len = (slash ? (size_t)(slash - u) : strlen(u));
-  if (len >= sizeof(hostport))
-    len = sizeof(hostport) - 1;
-  memcpy(hostport, u, len);
-  hostport[len] = '\0';
-
-  /* 포트가 명시됐는지 체크 */
-  char *colon = strchr(hostport, ':');
+  const char *colon = memchr(u, ':', len);
   if (colon)
   {
-    *colon = '\0';
-    strcpy(hostname, hostport);
-    strcpy(port, colon + 1);
+    dbuf_set(&c->hostname, u, (size_t)(colon - u));
+    dbuf_set(&c->port, colon + 1, len - (size_t)(colon - u) - 1);
   }
   else
   {
-    strcpy(hostname, hostport);
-    strcpy(port, "80");
+    dbuf_set(&c->hostname, u, len);
+    dbuf_set(&c->port, "80", 2);
+  }
+}
+
+/*
+ * make_cache_key(c)
+ *  - 정규화된 URL "http://host:port/path" (host는 소문자) 를 c->key 에 만든다.
+ */
+static void make_cache_key(conn_t *c)
+{
+  dbuf_set(&c->key, "http://", 7);
+  for (size_t i = 0; i < c->hostname.len; i++)
+  {
+    char ch = (char)tolower((unsigned char)c->hostname.data[i]);
+    dbuf_append(&c->key, &ch, 1);
   }
+  dbuf_printf(&c->key, ":%s%s", c->port.data, c->path.data);
 }
 
 /*
- * reassemble(req, path, hostname, port, other_header)
- *  - 원서버로 보낼 최종 요청 헤더를 조립한다.
+ * reassemble(c, validators)
+ *  - 원서버로 보낼 최종 요청 헤더를 c->req 에 조립한다.
  *  - 요청 라인: "GET <path> HTTP/1.0\r\n"
  *  - Host: (포트가 80이 아니면 host:port)
  *  - User-Agent: (과제 지정 UA 그대로)
  *  - Connection: close
  *  - Proxy-Connection: close
  *  - 나머지(other_header) 이어붙인 후, 마지막에 \r\n 한 줄(헤더 종료)
+ *  - validators가 있으면(캐시 재검증) 클라이언트의 조건부 헤더 대신
+ *    If-None-Match / If-Modified-Since 를 캐시 값으로 보낸다.
+ *  - Range / If-Range 는 미스일 때만 넘긴다(-r 이면 빼고 전체를 받는다).
  *
  * ⚠️ CRLF
  *  - 각 헤더는 \r\n 로 끝나야 하고, 마지막에는 빈 줄(\r\n)이 필요합니다.
  */
-static void reassemble(char *req, const char *path, const char *hostname,
-                       const char *port, const char *other_header)
+static void reassemble(conn_t *c, const cache_meta_t *validators)
 {
-  int n = 0;
+  dbuf_t *req = &c->req;
+
+  dbuf_reset(req);
 
   /* 요청 라인: HTTP/1.0 다운그레이드 */
-  n += snprintf(req + n, MAXBUF * 2 - n, "GET %s HTTP/1.0\r\n", path);
+  dbuf_printf(req, "GET %s HTTP/1.0\r\n", c->path.data);
 
   /* Host 헤더: 80이 아니면 host:port */
-  if (strcmp(port, "80") == 0)
-    n += snprintf(req + n, MAXBUF * 2 - n, "Host: %s\r\n", hostname);
+  if (strcmp(c->port.data, "80") == 0)
+    dbuf_printf(req, "Host: %s\r\n", c->hostname.data);
   else
-    n += snprintf(req + n, MAXBUF * 2 - n, "Host: %s:%s\r\n", hostname, port);
+    dbuf_printf(req, "Host: %s:%s\r\n", c->hostname.data, c->port.data);
 
   /* 지정된 User-Agent 고정 */
-  n += snprintf(req + n, MAXBUF * 2 - n, "%s", user_agent_hdr);
+  dbuf_puts(req, user_agent_hdr);
 
   /* 프록시/서버와의 연결을 명시적으로 종료(HTTP/1.0 close 모델) */
-  n += snprintf(req + n, MAXBUF * 2 - n, "Connection: close\r\n");
-  n += snprintf(req + n, MAXBUF * 2 - n, "Proxy-Connection: close\r\n");
+  dbuf_puts(req, "Connection: close\r\n");
+  dbuf_puts(req, "Proxy-Connection: close\r\n");
 
   /* 기타 헤더(원본에서 가져온 것)를 그대로 붙임 */
-  n += snprintf(req + n, MAXBUF * 2 - n, "%s", other_header);
+  dbuf_append(req, c->other_header.data, c->other_header.len);
+
+  /* Range — 재검증(전체를 받아야 304/200 어느 쪽이든 캐시에서 자를 수 있다)이나
+   * -r 이 아니면 원서버에 그대로 넘긴다 */
+  if (c->range_header.len && !validators)
+  {
+    if (range_whole)
+      STAT_INC(range_whole);
+    else
+      dbuf_append(req, c->range_header.data, c->range_header.len);
+  }
+
+  /* 조건부 헤더 — 재검증이면 캐시의 검증자, 아니면 클라이언트 것 그대로 */
+  if (validators)
+  {
+    if (validators->etag[0])
+      dbuf_printf(req, "If-None-Match: %s\r\n", validators->etag);
+    if (validators->last_modified[0])
+      dbuf_printf(req, "If-Modified-Since: %s\r\n", validators->last_modified);
+  }
+  else
+    dbuf_append(req, c->cond_header.data, c->cond_header.len);
 
   /* 헤더 종료 — 빈 줄 */
-  n += snprintf(req + n, MAXBUF * 2 - n, "\r\n");
+  dbuf_puts(req, "\r\n");
 }
 
 /*
- * forward_response(servedf, fd)
- *  - 원서버(servedf)의 응답을 EOF까지 읽어 클라이언트(fd)에 그대로 중계한다.
- *  - RIO의 바이트 단위 읽기(Rio_readnb)로 바이너리 컨텐츠도 안전하게 처리 가능.
- *  - chunked 인코딩/Content-Length 여부와 관계없이 소켓 닫힐 때까지 전송.
+ * forward_response(c, servedf, stale, stale_meta, request_time)
+ *  - 원서버 응답의 상태줄/헤더를 한 줄씩 읽어 캐시 판단에 필요한 필드를 파싱한다.
+ *  - 재검증 중(stale != NULL)에 304가 오면 메타데이터만 갱신하고 캐시 본문을 보낸다.
+ *    5xx(또는 빈 응답)이고 stale-if-error 창 안이면 원서버 응답 대신 캐시 본문을 보낸다.
+ *  - 그 외에는 헤더와 본문을 클라이언트(c->fd)에 중계한다. 본문 끝은 EOF가 아니라
+ *    Content-Length / chunked / 연결 종료 중 응답의 프레이밍(http_body_t)으로 판단하고,
+ *    프레이밍보다 일찍 끊긴 응답은 캐시하지 않는다.
+ *    저장 가능한 응답이면 최대 MAX_OBJECT_SIZE 까지 별도 버퍼에 모았다가
+ *    전송이 끝나면 캐시에 넣는다(넘치면 캐싱 포기).
+ *  - 본문이 RELAY_SPLICE_MIN 이상이거나 길이를 모르면 relay.c의 splice 경로로
+ *    중계한다(본문이 유저 공간을 거치지 않고, 캐시 사본은 tee → memfd).
  */
-static void forward_response(int servedf, int fd)
+static void forward_response(conn_t *c, int servedf, cache_entry_t *stale,
+                             const cache_meta_t *stale_meta, time_t request_time)
 {
-  rio_t s_rio;
-  char buf[MAXBUF];
+  rio_t *rp = &c->srv_rio;
+  dbuf_t *hdr = &c->rhdr;
+  dbuf_t obj = {0}; /* 캐시에 넣을 응답 사본 — 성공하면 소유권이 캐시로 넘어간다 */
+  http_meta_t hm;
   ssize_t n;
 
-  Rio_readinitb(&s_rio, servedf);
-  while ((n = Rio_readnb(&s_rio, buf, sizeof(buf))) > 0)
+  Rio_readinitb(rp, servedf);
+
+  /* 1) 상태줄 + 헤더 — HTTP 응답이 아니면(상태줄 파싱 실패) 그냥 바이트 중계 */
+  int got = http_read_response(rp, hdr, &c->line, &hm);
+  time_t response_time = time(NULL);
+
+  /* 2) 재검증 성공(304) — 본문을 다시 받지 않는다 */
+  if (stale && hm.status == 304)
   {
-    Rio_writen(fd, buf, (size_t)n);
+    cache_meta_t cm = *stale_meta;
+    cache_meta_revalidate(&cm, &hm, request_time, response_time);
+    cache_refresh(stale, &cm);
+    STAT_INC(revalidated);
+    serve_cached(c, stale, &cm, "REVALIDATED");
+    return;
+  }
+
+  /* 원서버 오류 — stale-if-error 창 안이면 만료 본문으로 대신 응답 */
+  if (stale && (!got || hm.status >= 500) &&
+      cache_can_serve_stale(stale_meta, response_time, stale_meta->sie))
+  {
+    STAT_INC(stale_if_error);
+    serve_cached(c, stale, stale_meta, "STALE");
+    return;
+  }
+  if (!got)
+    return;
+
+  /* 3) 헤더 + 본문 중계, 저장 가능하면 사본 누적
+   *    - 저장 여부는 헤더만 보고 여기서 정한다(상태 코드, no-store/private,
+   *      Set-Cookie, Content-Length vs MAX_OBJECT_SIZE). 담지 않을 응답은
+   *      사본 버퍼를 만들지 않는다.
+   *    - chunked는 청크 경계를 벗겨서 보낸다(클라이언트는 HTTP/1.0 —
+   *      연결 종료로 본문 끝을 알린다). Transfer-Encoding 줄도 뺀다.
+   */
+  int caching = hm.status && cache_storable(&hm);
+  http_framing_t framing = http_framing(&hm);
+  if (framing == HTTP_BODY_CHUNKED)
+    http_strip_header(hdr, "Transfer-Encoding");
+  Rio_writen(c->fd, hdr->data, hdr->len);
+  if (caching)
+    http_append_stored(&obj, hdr->data, hdr->len);
+  if (caching && !cache_fits(&hm, obj.len))
+  {
+    STAT_INC(cache_bypass_large);
+    caching = 0;
+    dbuf_free(&obj);
   }
+
+  /* 큰(또는 길이를 모르는) 본문은 splice로 중계하고, 캐시 사본은 tee로 memfd에 */
+  if ((framing == HTTP_BODY_LENGTH && hm.content_length >= RELAY_SPLICE_MIN) ||
+      (framing == HTTP_BODY_CLOSE && hm.status))
+  {
+    relay_fill_t fill = {.fd = -1};
+    char *data;
+
+    if (caching)
+      relay_fill_init(&fill, obj.data, obj.len, MAX_OBJECT_SIZE);
+    dbuf_free(&obj);
+    n = relay_body(rp, c->fd, &fill, framing == HTTP_BODY_LENGTH ? hm.content_length : -1);
+    if (n < 0 || (framing == HTTP_BODY_LENGTH && n < hm.content_length))
+    {
+      STAT_INC(origin_truncated);
+      relay_fill_abort(&fill);
+    }
+    if ((data = relay_fill_map(&fill)) != NULL)
+    {
+      cache_meta_t cm;
+      cache_meta_init(&cm, &hm, request_time, response_time);
+      cache_variant_key(&c->vkey, c->key.data, hm.vary, c->other_header.data);
+      cache_insert_mapped(c->vkey.data, data, fill.len, &cm, relay_fill_release);
+    }
+    return;
+  }
+
+  /* 그 밖에는 프레이밍 파서가 내주는 조각(RIO 버퍼 안)을 그대로 보낸다 */
+  http_body_t body;
+  const char *slice;
+
+  if (caching && framing == HTTP_BODY_LENGTH) /* 크기를 알면 딱 맞게 한 번만 할당 */
+    dbuf_reserve_exact(&obj, obj.len + (size_t)hm.content_length);
+  http_body_init(&body, rp, &c->line, &hm);
+  while ((n = http_body_next(&body, &slice)) > 0)
+  {
+    Rio_writen(c->fd, (void *)slice, (size_t)n);
+    if (!caching)
+      continue;
+    if (obj.len + (size_t)n > MAX_OBJECT_SIZE)
+    {
+      caching = 0; /* 100KiB 초과 — 캐싱 포기 */
+      dbuf_free(&obj);
+      continue;
+    }
+    dbuf_append(&obj, slice, (size_t)n);
+  }
+  if (body.truncated) /* 원서버가 본문 도중에 끊음 — 잘린 응답은 캐시하지 않는다 */
+  {
+    STAT_INC(origin_truncated);
+    caching = 0;
+    dbuf_free(&obj);
+  }
+
+  /* 4) 캐시 삽입(같은 키의 stale 엔트리는 교체된다)
+   *    - Vary가 있으면 요청 헤더 값으로 만든 변형 키로 넣는다
+   */
+  if (caching)
+  {
+    cache_meta_t cm;
+    cache_meta_init(&cm, &hm, request_time, response_time);
+    cache_variant_key(&c->vkey, c->key.data, hm.vary, c->other_header.data);
+    cache_insert(c->vkey.data, obj.data, obj.len, &cm);
+  }
+}
+
+/*
+ * serve_disk(c, now)
+ *  - 메모리 미스일 때 디스크 2차 캐시를 본다.
+ *  - fresh 레코드면 세그먼트 파일에서 sendfile로 바로 보내고 1.
+ *  - 없거나 stale이면 0 → 평소처럼 원서버에서 받아 메모리 캐시에 넣는다
+ *    (새 버전이 나중에 다시 밀려나면 디스크 인덱스도 그걸로 바뀐다).
+ */
+static int serve_disk(conn_t *c, time_t now)
+{
+  disk_obj_t obj;
+
+  if (!disk_enabled() || !disk_lookup(c->key.data, &obj))
+    return 0;
+  if (!cache_is_fresh(&obj.meta, now))
+  {
+    disk_release(&obj);
+    return 0;
+  }
+  char extra[128];
+  size_t extra_len = hit_headers(extra, sizeof(extra), &obj.meta, "HIT");
+
+  STAT_INC(disk_hit);
+  disk_send(c->fd, &obj, extra, extra_len);
+  disk_release(&obj);
+  return 1;
+}
+
+/*
+ * hit_headers(buf, n, meta, xcache)
+ *  - 캐시 응답의 헤더 블록 끝에 붙일 줄들을 만든다(헤더를 끝내는 빈 줄 포함).
+ *      Age: <current_age>
+ *      X-Cache: HIT | STALE | REVALIDATED
+ *  - 반환: buf에 쓴 길이
+ */
+static size_t hit_headers(char *buf, size_t n, const cache_meta_t *meta, const char *xcache)
+{
+  int len = snprintf(buf, n, "Age: %ld\r\nX-Cache: %s\r\n\r\n",
+                     cache_current_age(meta, time(NULL)), xcache);
+
+  return len < 0 ? 0 : (size_t)len < n ? (size_t)len : n - 1;
+}
+
+/*
+ * serve_cached(c, e, meta, xcache)
+ *  - 캐시된 응답을 [헤더 블록][Age/X-Cache + 빈 줄][본문] 세 조각으로
+ *    writev 한 번에 보낸다. 헤더 블록과 본문은 캐시 메모리에서 바로 나간다.
+ *  - 요청에 Range가 있으면 range_send()가 본문을 잘라 206(또는 416)으로 보낸다.
+ *  - e는 호출자가 참조를 잡고 있으므로 락 없이 읽어도 해제되지 않는다.
+ *  - meta는 호출자가 가진 사본(Age 계산용 — e->meta는 락 없이 읽지 않는다).
+ */
+static void serve_cached(conn_t *c, cache_entry_t *e, const cache_meta_t *meta,
+                         const char *xcache)
+{
+  struct iovec iov[3];
+  char extra[128];
+  size_t extra_len;
+
+  if (!e->hdr_len) /* 헤더 블록을 못 찾은 응답은 그대로 */
+  {
+    Rio_writen(c->fd, e->data, e->size);
+    return;
+  }
+  extra_len = hit_headers(extra, sizeof(extra), meta, xcache);
+  if (c->range_header.len &&
+      range_send(c->fd, e, meta, c->range_header.data, extra, extra_len))
+    return;
+  iov[0].iov_base = e->data;
+  iov[0].iov_len = e->hdr_len;
+  iov[1].iov_base = extra;
+  iov[1].iov_len = extra_len;
+  iov[2].iov_base = e->data + e->hdr_len + 2; /* 원래 빈 줄은 extra가 대신한다 */
+  iov[2].iov_len = e->size - e->hdr_len - 2;
+  conn_writev(c->fd, iov, 3);
 }
 
 /*
@@ -389,7 +898,7 @@ static void clienterror(int fd, const char *cause,
  *  - detached thread(pthread_detach)로 조인 없이 수거
  *  - 공유 자원이 생기면 적절한 락 보호 필요
  *
- * [Part III: 캐시]
+ * [Part III: 캐시] — cache.c 에 구현(신선도/재검증 포함)
  *  - 키: 정규화된 URL (http://host:port/path) — parse_uri 결과로 구성
  *  - 값: 응답 객체(≤100KiB), 총합 ≤1MiB
  *  - 정책: (근사)LRU, 다중 읽기 동시 허용 — pthread_rwlock_t 권장
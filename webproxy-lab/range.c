@@ -0,0 +1,226 @@
+/*
+ * range.c — Range / If-Range 응답 구현
+ *
+ * ✅ 보내는 모양
+ *   - 206 단일:  [헤더][본문 조각]
+ *   - 206 다중:  [헤더]([부분 헤더][본문 조각])...[닫는 경계]
+ *   - 헤더는 저장된 헤더 블록에서 상태줄을 바꾸고 Content-Length(다중이면
+ *     Content-Type도)를 새 값으로 갈아 끼운 것 + Age/X-Cache(extra).
+ */
+#include "range.h"
+#include "stats.h"
+
+/*
+ * range_parse(spec, len, r, max)
+ *  - "bytes=0-99,200-,-50" 을 본문 길이 len에 맞춰 r[]에 푼다.
+ *    끝이 len을 넘으면 len-1로 자르고, 시작이 len 이상인 범위는 버린다.
+ *  - 반환: 만족하는 범위 수(>0), 모두 벗어나면 -1,
+ *          Range를 무시해야 하면(bytes가 아님, 문법 오류, max개 초과) 0
+ */
+int range_parse(const char *spec, long len, range_t *r, int max)
+{
+  int n = 0, seen = 0;
+  char *end;
+
+  if (strncasecmp(spec, "bytes=", 6))
+    return 0;
+  spec += 6;
+  while (*spec)
+  {
+    long first = -1, last = -1;
+
+    while (*spec == ' ' || *spec == '\t' || *spec == ',')
+      spec++;
+    if (!*spec)
+      break;
+    if (isdigit((unsigned char)*spec))
+    {
+      first = strtol(spec, &end, 10);
+      spec = end;
+    }
+    if (*spec++ != '-')
+      return 0;
+    if (isdigit((unsigned char)*spec))
+    {
+      last = strtol(spec, &end, 10);
+      spec = end;
+    }
+    while (*spec == ' ' || *spec == '\t')
+      spec++;
+    if ((*spec && *spec != ',') || (first < 0 && last < 0) ||
+        (first >= 0 && last >= 0 && last < first) || ++seen > max)
+      return 0;
+
+    if (first < 0) /* "-N": 마지막 N 바이트 */
+    {
+      if (last == 0 || len == 0)
+        continue;
+      first = last >= len ? 0 : len - last;
+      last = len - 1;
+    }
+    else
+    {
+      if (first >= len)
+        continue;
+      if (last < 0 || last >= len)
+        last = len - 1;
+    }
+    r[n].first = first;
+    r[n].last = last;
+    n++;
+  }
+  if (seen == 0)
+    return 0;
+  return n > 0 ? n : -1;
+}
+
+/* If-Range 값이 캐시의 검증자와 맞는지 — ETag는 강한 비교, 날짜는 Last-Modified와 정확히 일치 */
+static int if_range_match(const char *v, size_t n, const cache_meta_t *meta)
+{
+  int tag = *v == '"' || (n >= 2 && !strncmp(v, "W/", 2));
+  const char *want = tag ? meta->etag : meta->last_modified;
+
+  if (tag && (*v == 'W' || !strncmp(want, "W/", 2)))
+    return 0;
+  return want[0] && strlen(want) == n && !strncmp(v, want, n);
+}
+
+/*
+ * stored_headers(h, e, status, ctype, n)
+ *  - 저장된 헤더 블록을 상태줄만 바꿔 h에 옮긴다. Content-Length는 새로 붙이므로 뺀다.
+ *  - ctype이 있으면(다중 범위) Content-Type도 빼고 그 값을 ctype에 담는다.
+ */
+static void stored_headers(dbuf_t *h, const cache_entry_t *e, const char *status,
+                           char *ctype, size_t n)
+{
+  const char *p = e->data, *end = e->data + e->hdr_len;
+  size_t vlen = strcspn(p, " \r\n");
+
+  dbuf_append(h, p, vlen < e->hdr_len ? vlen : 0);
+  dbuf_printf(h, " %s\r\n", status);
+  while (p < end && *p++ != '\n')
+    ; /* 원래 상태줄 건너뛰기 */
+  while (p < end)
+  {
+    const char *nl = memchr(p, '\n', (size_t)(end - p));
+    size_t len = nl ? (size_t)(nl - p) + 1 : (size_t)(end - p);
+
+    if (!strncasecmp(p, "Content-Length:", 15))
+      ;
+    else if (ctype && !strncasecmp(p, "Content-Type:", 13))
+    {
+      const char *v = p + 13;
+      size_t m;
+
+      while (*v == ' ' || *v == '\t')
+        v++;
+      m = strcspn(v, "\r\n");
+      if (m >= n)
+        m = n - 1;
+      memcpy(ctype, v, m);
+      ctype[m] = '\0';
+    }
+    else
+      dbuf_append(h, p, len);
+    p += len;
+  }
+}
+
+/*
+ * range_send(fd, e, meta, req_hdrs, extra, extra_len)
+ *  - req_hdrs(클라이언트의 Range / If-Range 줄)에 맞춰 캐시 엔트리 e에서 206/416을 보낸다.
+ *  - extra: 헤더 블록 끝에 붙일 Age/X-Cache 줄과 빈 줄
+ *  - 반환: 보냈으면 1, Range를 적용하지 않으면 0(호출자가 전체 200을 보낸다)
+ */
+int range_send(int fd, const cache_entry_t *e, const cache_meta_t *meta,
+               const char *req_hdrs, const char *extra, size_t extra_len)
+{
+  range_t r[RANGE_MAX];
+  struct iovec iov[2 * RANGE_MAX + 2];
+  size_t head_off[RANGE_MAX + 1];
+  char spec[MAXLINE], ctype[MAXLINE] = "", boundary[32];
+  dbuf_t h = {0}, parts = {0};
+  const char *v, *body;
+  size_t vlen;
+  long len, total;
+  int n, cnt = 0;
+
+  if (!e->hdr_len || meta->status != 200 || !(v = http_find_header(req_hdrs, "Range", &vlen)) || vlen >= sizeof(spec))
+    return 0;
+  memcpy(spec, v, vlen);
+  spec[vlen] = '\0';
+  if ((v = http_find_header(req_hdrs, "If-Range", &vlen)) && !if_range_match(v, vlen, meta))
+    return 0; /* 클라이언트가 가진 조각과 다른 버전 — 전체를 다시 보낸다 */
+
+  body = e->data + e->hdr_len + 2;
+  len = (long)(e->size - e->hdr_len - 2);
+  if ((n = range_parse(spec, len, r, RANGE_MAX)) == 0)
+    return 0;
+
+  if (n < 0)
+  {
+    stored_headers(&h, e, "416 Range Not Satisfiable", NULL, 0);
+    dbuf_printf(&h, "Content-Range: bytes */%ld\r\nContent-Length: 0\r\n", len);
+    dbuf_append(&h, extra, extra_len);
+    rio_writen(fd, h.data, h.len);
+    dbuf_free(&h);
+    STAT_INC(range_not_satisfiable);
+    return 1;
+  }
+
+  if (n == 1)
+  {
+    stored_headers(&h, e, "206 Partial Content", NULL, 0);
+    dbuf_printf(&h, "Content-Range: bytes %ld-%ld/%ld\r\nContent-Length: %ld\r\n",
+                r[0].first, r[0].last, len, r[0].last - r[0].first + 1);
+    dbuf_append(&h, extra, extra_len);
+    iov[0].iov_base = h.data;
+    iov[0].iov_len = h.len;
+    iov[1].iov_base = (char *)body + r[0].first;
+    iov[1].iov_len = (size_t)(r[0].last - r[0].first + 1);
+    conn_writev(fd, iov, 2);
+    dbuf_free(&h);
+    STAT_INC(range_hit);
+    return 1;
+  }
+
+  /* 다중 범위 — 부분 헤더를 먼저 다 만들어 전체 길이를 알아낸 뒤 헤더를 쓴다 */
+  stored_headers(&h, e, "206 Partial Content", ctype, sizeof(ctype));
+  snprintf(boundary, sizeof(boundary), "prx%016lx",
+           (unsigned long)(uintptr_t)e ^ (unsigned long)time(NULL));
+  total = 0;
+  for (int i = 0; i < n; i++)
+  {
+    head_off[i] = parts.len;
+    dbuf_printf(&parts, "\r\n--%s\r\n", boundary);
+    if (ctype[0])
+      dbuf_printf(&parts, "Content-Type: %s\r\n", ctype);
+    dbuf_printf(&parts, "Content-Range: bytes %ld-%ld/%ld\r\n\r\n", r[i].first, r[i].last, len);
+    total += r[i].last - r[i].first + 1;
+  }
+  head_off[n] = parts.len;
+  dbuf_printf(&parts, "\r\n--%s--\r\n", boundary);
+  total += (long)parts.len;
+
+  dbuf_printf(&h, "Content-Type: multipart/byteranges; boundary=%s\r\nContent-Length: %ld\r\n",
+              boundary, total);
+  dbuf_append(&h, extra, extra_len);
+
+  iov[cnt].iov_base = h.data;
+  iov[cnt++].iov_len = h.len;
+  for (int i = 0; i < n; i++)
+  {
+    iov[cnt].iov_base = parts.data + head_off[i];
+    iov[cnt++].iov_len = head_off[i + 1] - head_off[i];
+    iov[cnt].iov_base = (char *)body + r[i].first;
+    iov[cnt++].iov_len = (size_t)(r[i].last - r[i].first + 1);
+  }
+  iov[cnt].iov_base = parts.data + head_off[n];
+  iov[cnt++].iov_len = parts.len - head_off[n];
+  conn_writev(fd, iov, cnt);
+
+  dbuf_free(&h);
+  dbuf_free(&parts);
+  STAT_INC(range_hit);
+  return 1;
+}
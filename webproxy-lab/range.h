@@ -0,0 +1,38 @@
+/*
+ * range.h — 캐시된 전체 객체에서 Range 요청에 답하기 (RFC 9110 §14)
+ *
+ * ✅ 동작
+ *   - 요청의 Range: bytes=... 를 캐시 본문 길이에 맞춰 해석한다.
+ *       범위 하나   → 206 Partial Content + Content-Range
+ *       범위 여럿   → 206 multipart/byteranges (부분마다 Content-Type/Content-Range)
+ *       모두 벗어남 → 416 Range Not Satisfiable (Content-Range에는 전체 길이만)
+ *   - If-Range가 캐시의 검증자와 맞지 않으면(강한 ETag 비교 또는 Last-Modified 일치)
+ *     Range를 무시하고 전체를 보낸다.
+ *   - 문법이 틀리거나 범위가 RANGE_MAX개를 넘으면 Range를 무시한다(전체 200).
+ *   - 본문 조각은 캐시 메모리를 가리키는 iovec으로 writev 한 번에 보낸다.
+ *
+ * ⚠️ 범위
+ *   - 메모리 캐시 히트(HIT/STALE/REVALIDATED)의 200 객체에만 적용한다.
+ *     디스크 히트는 전체 200으로 답한다(Range를 무시해도 규격 위반 아님).
+ *   - 미스는 Range를 원서버에 그대로 넘긴다(206은 캐시하지 않는다).
+ *     proxy -r 이면 Range를 빼고 전체 객체를 한 번 받아 캐시한다 — 그 첫 응답은
+ *     전체 200이고, 이후 같은 객체의 Range 요청은 여기서 히트로 답한다.
+ */
+#ifndef __RANGE_H__
+#define __RANGE_H__
+
+#include "cache.h"
+#include <stdint.h>
+
+#define RANGE_MAX 16 /* 한 요청에서 받아 주는 범위 수 */
+
+typedef struct
+{
+  long first, last; /* 본문 안의 바이트 위치(양끝 포함) */
+} range_t;
+
+int range_parse(const char *spec, long len, range_t *r, int max);
+int range_send(int fd, const cache_entry_t *e, const cache_meta_t *meta,
+               const char *req_hdrs, const char *extra, size_t extra_len);
+
+#endif /* __RANGE_H__ */
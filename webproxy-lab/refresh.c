@@ -0,0 +1,199 @@
+/*
+ * refresh.c — 백그라운드 갱신 풀 구현
+ *
+ * ⚠️ 갱신 스레드는 클라이언트가 없으므로, 원서버 오류로 프로세스가 죽지 않도록
+ *    소문자 rio_* / open_clientfd 를 쓰고 오류는 카운터로만 남긴다.
+ */
+#include "refresh.h"
+#include "stats.h"
+
+typedef struct
+{
+  cache_entry_t *e;  /* 참조를 잡고 있음 — 작업이 끝나면 release */
+  cache_meta_t meta; /* 예약 시점의 메타(검증자 포함) */
+  char *key, *hostname, *port;
+  char *req; /* 검증자가 들어간 조건부 요청 전체 */
+  size_t req_len;
+} refresh_job_t;
+
+/* sbuf 방식의 유한 큐 */
+static refresh_job_t *jobs[REFRESH_QUEUE];
+static int front, rear;
+static sem_t mutex, slots, items;
+
+static void job_free(refresh_job_t *j)
+{
+  cache_end_refresh(j->e);
+  cache_release(j->e);
+  free(j->key);
+  free(j->hostname);
+  free(j->port);
+  free(j->req);
+  free(j);
+}
+
+/*
+ * refresh_run(j)
+ *  - 조건부 요청을 보내고 응답에 따라 캐시를 갱신한다.
+ */
+static void refresh_run(refresh_job_t *j)
+{
+  rio_t rio;
+  dbuf_t hdr = {0}, line = {0}, obj = {0};
+  http_meta_t hm;
+  http_body_t body;
+  const char *slice;
+  ssize_t n;
+  int fd;
+
+  if ((fd = open_clientfd(j->hostname, j->port)) < 0)
+  {
+    STAT_INC(refresh_error);
+    return;
+  }
+
+  time_t request_time = time(NULL);
+  if (rio_writen(fd, j->req, j->req_len) != (ssize_t)j->req_len)
+  {
+    STAT_INC(refresh_error);
+    goto out;
+  }
+
+  rio_readinitb(&rio, fd);
+  if (!http_read_response(&rio, &hdr, &line, &hm))
+  {
+    STAT_INC(refresh_error);
+    goto out;
+  }
+  time_t response_time = time(NULL);
+
+  if (hm.status == 304)
+  {
+    cache_meta_t cm = j->meta;
+    cache_meta_revalidate(&cm, &hm, request_time, response_time);
+    cache_refresh(j->e, &cm);
+    STAT_INC(refresh_304);
+    goto out;
+  }
+  if (!cache_storable(&hm))
+  {
+    STAT_INC(refresh_error);
+    goto out;
+  }
+  if (strcmp(hm.vary, j->meta.vary))
+  {
+    /* Vary 목록이 바뀌어 이 변형 키(j->key)로는 넣을 수 없다 — 다음 요청이 새로 받게 */
+    cache_remove(j->key);
+    STAT_INC(refresh_error);
+    goto out;
+  }
+
+  /* 새 본문 — 헤더 + 본문을 모아서 교체(100KiB 초과거나 잘린 응답이면 포기) */
+  if (http_framing(&hm) == HTTP_BODY_CHUNKED)
+    http_strip_header(&hdr, "Transfer-Encoding");
+  http_append_stored(&obj, hdr.data, hdr.len);
+  if (!cache_fits(&hm, obj.len))
+  {
+    dbuf_free(&obj);
+    STAT_INC(refresh_error);
+    goto out;
+  }
+  if (http_framing(&hm) == HTTP_BODY_LENGTH)
+    dbuf_reserve_exact(&obj, obj.len + (size_t)hm.content_length);
+  http_body_init(&body, &rio, &line, &hm);
+  while ((n = http_body_next(&body, &slice)) > 0)
+  {
+    if (obj.len + (size_t)n > MAX_OBJECT_SIZE)
+    {
+      n = -1;
+      break;
+    }
+    dbuf_append(&obj, slice, (size_t)n);
+  }
+  if (n < 0 || body.truncated)
+  {
+    dbuf_free(&obj);
+    STAT_INC(refresh_error);
+    goto out;
+  }
+
+  cache_meta_t cm;
+  cache_meta_init(&cm, &hm, request_time, response_time);
+  cache_insert(j->key, obj.data, obj.len, &cm);
+  STAT_INC(refresh_200);
+
+out:
+  close(fd);
+  dbuf_free(&hdr);
+  dbuf_free(&line);
+}
+
+static void *refresh_thread(void *vargp)
+{
+  Pthread_detach(pthread_self());
+  while (1)
+  {
+    refresh_job_t *j;
+
+    P(&items);
+    P(&mutex);
+    j = jobs[(++front) % REFRESH_QUEUE];
+    V(&mutex);
+    V(&slots);
+
+    refresh_run(j);
+    job_free(j);
+  }
+  return NULL;
+}
+
+void refresh_init(void)
+{
+  pthread_t tid;
+
+  front = rear = 0;
+  Sem_init(&mutex, 0, 1);
+  Sem_init(&slots, 0, REFRESH_QUEUE);
+  Sem_init(&items, 0, 0);
+  for (int i = 0; i < REFRESH_THREADS; i++)
+    Pthread_create(&tid, NULL, refresh_thread, NULL);
+}
+
+/*
+ * refresh_submit(e, meta, key, hostname, port, req, req_len)
+ *  - e에 대한 갱신을 예약한다. 이미 예약돼 있거나 큐가 가득 차면 0.
+ *  - 성공하면 e의 참조를 하나 더 잡아 작업이 끝날 때까지 유지한다.
+ */
+int refresh_submit(cache_entry_t *e, const cache_meta_t *meta,
+                   const char *key, const char *hostname, const char *port,
+                   const char *req, size_t req_len)
+{
+  refresh_job_t *j;
+
+  if (!cache_begin_refresh(e))
+    return 0; /* 다른 스레드가 이미 예약 — 한 객체당 갱신은 하나만 */
+
+  if (sem_trywait(&slots) < 0)
+  {
+    cache_end_refresh(e);
+    STAT_INC(refresh_dropped);
+    return 0;
+  }
+
+  j = Calloc(1, sizeof(*j));
+  j->e = cache_retain(e);
+  j->meta = *meta;
+  j->key = strdup(key);
+  j->hostname = strdup(hostname);
+  j->port = strdup(port);
+  j->req = Malloc(req_len);
+  memcpy(j->req, req, req_len);
+  j->req_len = req_len;
+
+  P(&mutex);
+  jobs[(++rear) % REFRESH_QUEUE] = j;
+  V(&mutex);
+  V(&items);
+  STAT_INC(refresh_queued);
+  return 1;
+}
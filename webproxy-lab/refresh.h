@@ -0,0 +1,25 @@
+/*
+ * refresh.h — stale-while-revalidate 백그라운드 갱신 풀
+ *
+ * ✅ 동작
+ *   - doit()이 SWR 창 안의 stale 엔트리를 만나면 본문은 바로 보내고,
+ *     갱신 작업만 refresh_submit()으로 큐에 넣는다.
+ *   - 작은 전용 스레드 풀(REFRESH_THREADS)이 큐에서 꺼내 원서버에 조건부 요청을 보낸다.
+ *       304 → 메타데이터만 갱신, 200(저장 가능) → 새 본문으로 교체, 그 외 → 실패 카운트
+ *   - 큐(sbuf 방식: 세마포어 + 원형 버퍼)가 가득 차면 예약을 포기한다.
+ *     포그라운드 요청이 갱신 때문에 기다리는 일은 없다.
+ */
+#ifndef __REFRESH_H__
+#define __REFRESH_H__
+
+#include "cache.h"
+
+#define REFRESH_THREADS 2
+#define REFRESH_QUEUE 64
+
+void refresh_init(void);
+int refresh_submit(cache_entry_t *e, const cache_meta_t *meta,
+                   const char *key, const char *hostname, const char *port,
+                   const char *req, size_t req_len);
+
+#endif /* __REFRESH_H__ */
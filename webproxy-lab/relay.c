@@ -0,0 +1,190 @@
+/*
+ * relay.c — splice/tee 기반 본문 중계 구현
+ *
+ * ✅ 한 바퀴
+ *   1) splice(원서버 → p1)                 최대 RELAY_CHUNK
+ *   2) 캐싱 중이면 tee(p1 → p2) 후 splice(p2 → memfd)
+ *   3) splice(p1 → 클라이언트)             tee로 복제한 만큼을 끝까지
+ *   - 3)이 부분 전송이어도 같은 바이트를 다시 tee하지 않도록, 복제한 덩어리를
+ *     다 보낼 때까지 3)만 반복한다.
+ */
+#include "relay.h"
+#include "stats.h"
+#include <sys/mman.h>
+
+/*
+ * relay_fill_init(f, hdr, hdr_len, max)
+ *  - memfd를 만들고 캐시에 저장할 헤더 블록부터 써 둔다.
+ *  - memfd를 만들 수 없으면 f->fd = -1 (캐싱 없이 중계만).
+ */
+void relay_fill_init(relay_fill_t *f, const char *hdr, size_t hdr_len, size_t max)
+{
+  f->len = 0;
+  f->max = max;
+  if ((f->fd = memfd_create("proxy-obj", MFD_CLOEXEC)) < 0)
+    return;
+  if (hdr_len > max || rio_writen(f->fd, (void *)hdr, hdr_len) != (ssize_t)hdr_len)
+  {
+    relay_fill_abort(f);
+    return;
+  }
+  f->len = hdr_len;
+}
+
+void relay_fill_abort(relay_fill_t *f)
+{
+  if (f->fd >= 0)
+    close(f->fd);
+  f->fd = -1;
+}
+
+/*
+ * relay_fill_map(f)
+ *  - 다 채운 memfd를 읽기 전용으로 매핑해 돌려준다(fd는 닫는다 — 매핑이 살아 있는 한
+ *    메모리는 유지된다). 캐싱 중이 아니었거나 실패하면 NULL.
+ */
+char *relay_fill_map(relay_fill_t *f)
+{
+  char *data;
+
+  if (f->fd < 0 || f->len == 0)
+  {
+    relay_fill_abort(f);
+    return NULL;
+  }
+  data = mmap(NULL, f->len, PROT_READ, MAP_SHARED, f->fd, 0);
+  relay_fill_abort(f);
+  return data == MAP_FAILED ? NULL : data;
+}
+
+/* 캐시 엔트리 해제 함수(cache_release_fn) */
+void relay_fill_release(char *data, size_t size)
+{
+  munmap(data, size);
+}
+
+/* p2에 복제해 둔 n 바이트를 memfd 끝으로 */
+static int fill_drain(relay_fill_t *f, int from, size_t n)
+{
+  loff_t off = f->len;
+
+  while (n > 0)
+  {
+    ssize_t m = splice(from, NULL, f->fd, &off, n, SPLICE_F_MOVE);
+    if (m < 0 && errno == EINTR)
+      continue;
+    if (m <= 0)
+      return -1;
+    n -= (size_t)m;
+  }
+  f->len = (size_t)off;
+  return 0;
+}
+
+/* pipe → 소켓으로 n 바이트 전부 */
+static int splice_all(int from, int to, size_t n)
+{
+  while (n > 0)
+  {
+    ssize_t m = splice(from, NULL, to, NULL, n, SPLICE_F_MOVE);
+    if (m < 0 && errno == EINTR)
+      continue;
+    if (m <= 0)
+      return -1;
+    n -= (size_t)m;
+  }
+  return 0;
+}
+
+/*
+ * relay_body(rp, dst, fill, limit)
+ *  - rp의 버퍼에 남은 본문을 먼저 보내고, 나머지는 rp의 소켓에서 splice 한다.
+ *  - limit: 본문 길이(Content-Length). 음수면 EOF까지. 반환값이 limit보다 작으면
+ *    원서버가 도중에 끊은 것이다.
+ *  - fill->fd >= 0 이면 같은 바이트를 memfd에도 쌓는다. fill->max를 넘으면
+ *    캐싱만 포기하고 중계는 계속한다.
+ *  - 반환: 중계한 본문 바이트 수, 원서버/클라이언트 오류면 -1
+ */
+ssize_t relay_body(rio_t *rp, int dst, relay_fill_t *fill, long limit)
+{
+  int p1[2], p2[2] = {-1, -1};
+  ssize_t total = 0;
+  size_t left = limit < 0 ? SIZE_MAX : (size_t)limit;
+
+  /* 1) 헤더와 함께 RIO 버퍼로 들어온 본문 앞부분 */
+  if (rp->rio_cnt > 0)
+  {
+    size_t n = (size_t)rp->rio_cnt < left ? (size_t)rp->rio_cnt : left;
+
+    if (rio_writen(dst, rp->rio_bufptr, n) != (ssize_t)n)
+      return -1;
+    if (fill->fd >= 0 &&
+        (fill->len + n > fill->max || rio_writen(fill->fd, rp->rio_bufptr, n) != (ssize_t)n))
+      relay_fill_abort(fill);
+    else if (fill->fd >= 0)
+      fill->len += n;
+    rp->rio_bufptr += n;
+    rp->rio_cnt -= n;
+    total += (ssize_t)n;
+    left -= n;
+  }
+
+  if (pipe2(p1, O_CLOEXEC) < 0)
+    return -1;
+  if (fill->fd >= 0 && pipe2(p2, O_CLOEXEC) < 0)
+    relay_fill_abort(fill);
+
+  /* 2) 나머지 — 커널 안에서만 이동 */
+  while (left > 0)
+  {
+    ssize_t in = splice(rp->rio_fd, NULL, p1[1], NULL,
+                        left < RELAY_CHUNK ? left : RELAY_CHUNK, SPLICE_F_MOVE);
+    if (in < 0 && errno == EINTR)
+      continue;
+    if (in <= 0)
+    {
+      if (in < 0)
+        total = -1;
+      break; /* EOF */
+    }
+
+    while (in > 0)
+    {
+      size_t chunk = (size_t)in;
+
+      if (fill->fd >= 0)
+      {
+        ssize_t t = tee(p1[0], p2[1], chunk, 0);
+        if (t <= 0 || fill->len + (size_t)t > fill->max || fill_drain(fill, p2[0], (size_t)t) < 0)
+        {
+          relay_fill_abort(fill); /* p2에 남은 복제본은 pipe를 닫을 때 버려진다 */
+          close(p2[0]);
+          close(p2[1]);
+          p2[0] = p2[1] = -1;
+        }
+        else
+          chunk = (size_t)t;
+      }
+      if (splice_all(p1[0], dst, chunk) < 0)
+      {
+        total = -1;
+        goto out;
+      }
+      in -= (ssize_t)chunk;
+      total += (ssize_t)chunk;
+      left -= chunk;
+    }
+  }
+
+out:
+  close(p1[0]);
+  close(p1[1]);
+  if (p2[0] >= 0)
+  {
+    close(p2[0]);
+    close(p2[1]);
+  }
+  if (total > 0)
+    STAT_ADD(splice_bytes, (long)total);
+  return total;
+}
@@ -0,0 +1,39 @@
+/*
+ * relay.h — splice/tee 기반 본문 중계
+ *
+ * ✅ 동작
+ *   - 원서버 소켓 → pipe → 클라이언트 소켓을 splice()로 옮긴다.
+ *     본문 바이트가 유저 공간으로 올라오지 않는다.
+ *   - 캐시에 넣을 응답이면 pipe의 내용을 tee()로 두 번째 pipe에 복제하고,
+ *     그쪽을 memfd(익명 메모리 파일)로 splice 해서 쌓는다.
+ *   - 중계가 끝나면 memfd를 mmap 해서 그대로 캐시 엔트리 본문으로 쓴다
+ *     (엔트리가 해제될 때 relay_fill_release()가 munmap).
+ *
+ * ⚠️ RIO와 섞어 쓰기
+ *   - 헤더를 RIO로 읽는 동안 본문 앞부분이 RIO 버퍼에 이미 들어와 있을 수 있다.
+ *     relay_body()는 그 부분을 먼저 보내고 나머지만 소켓에서 splice 한다.
+ */
+#ifndef __RELAY_H__
+#define __RELAY_H__
+
+#include "csapp.h"
+#include <stdint.h>
+
+#define RELAY_CHUNK (64 * 1024)      /* splice 한 번의 최대 크기(pipe 기본 용량) */
+#define RELAY_SPLICE_MIN (16 * 1024) /* Content-Length가 이보다 작으면 기존 복사 경로 */
+
+/* memfd에 쌓고 있는 캐시 사본 */
+typedef struct
+{
+  int fd;     /* memfd, -1이면 캐싱하지 않음(또는 포기) */
+  size_t len; /* 지금까지 쓴 바이트(헤더 블록 포함) */
+  size_t max; /* 이보다 커지면 포기 */
+} relay_fill_t;
+
+void relay_fill_init(relay_fill_t *f, const char *hdr, size_t hdr_len, size_t max);
+void relay_fill_abort(relay_fill_t *f);
+char *relay_fill_map(relay_fill_t *f);
+void relay_fill_release(char *data, size_t size);
+ssize_t relay_body(rio_t *rp, int dst, relay_fill_t *fill, long limit);
+
+#endif /* __RELAY_H__ */
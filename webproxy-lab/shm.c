@@ -0,0 +1,344 @@
+/*
+ * shm.c — 프로세스 간 공유 캐시 구현
+ *
+ * ✅ 세그먼트 생성/연결
+ *   - shm_open(O_CREAT | O_EXCL)에 성공한 프로세스가 생성자: 크기를 잡고 헤더와
+ *     robust mutex를 초기화한 뒤 ready = 1 을 찍는다.
+ *   - 나머지는 기존 세그먼트에 붙고 ready가 설 때까지 기다린다.
+ *     헤더 크기/객체 헤더 크기가 다르면(다른 빌드가 만든 세그먼트) 시작을 거부한다.
+ *   - 세그먼트는 프로세스가 모두 끝나도 남는다(다음 시작 때 그대로 재사용).
+ *     비우려면 /dev/shm/<name> 을 지운다.
+ */
+#include "shm.h"
+#include "stats.h"
+#include <sys/mman.h>
+
+typedef struct
+{
+  uint32_t magic;
+  uint32_t ready;    /* 생성자가 초기화를 끝내면 1 */
+  uint64_t size;     /* 세그먼트 전체 크기 */
+  uint32_t hdr_size; /* sizeof(shm_hdr_t) */
+  uint32_t obj_size; /* sizeof(shm_obj_t) */
+  pthread_mutex_t lock;
+  uint64_t pages_off; /* 첫 페이지 오프셋 */
+  uint32_t npages;
+  uint32_t used_pages; /* 등급에 배정된 페이지 수(앞에서부터) */
+  uint64_t free_head[SHM_CLASSES];
+  uint64_t lru_head[SHM_CLASSES], lru_tail[SHM_CLASSES];
+  uint64_t buckets[SHM_BUCKETS];
+} shm_hdr_t;
+
+typedef struct
+{
+  uint64_t hnext;      /* 해시 체인(빈 블록이면 free list) */
+  uint64_t prev, next; /* 등급별 LRU (head = 최근) */
+  uint32_t cls;
+  uint32_t key_len;
+  uint64_t data_len;
+  cache_meta_t meta;
+  char bytes[]; /* 키(NUL 포함) + 본문 */
+} shm_obj_t;
+
+static char *base;
+static shm_hdr_t *hdr;
+
+#define OBJ(off) ((shm_obj_t *)(base + (off)))
+#define OFF(o) ((uint64_t)((char *)(o) - base))
+
+static unsigned hash_key(const char *key)
+{
+  unsigned h = 5381;
+
+  while (*key)
+    h = h * 33 + (unsigned char)*key++;
+  return h % SHM_BUCKETS;
+}
+
+/* need 바이트가 들어가는 가장 작은 등급(없으면 -1) */
+static int size_class(size_t need)
+{
+  for (int cls = 0; cls < SHM_CLASSES; cls++)
+    if (need <= (size_t)1 << (SHM_MIN_SHIFT + cls))
+      return cls;
+  return -1;
+}
+
+static void lru_unlink(shm_obj_t *o)
+{
+  if (o->prev)
+    OBJ(o->prev)->next = o->next;
+  else
+    hdr->lru_head[o->cls] = o->next;
+  if (o->next)
+    OBJ(o->next)->prev = o->prev;
+  else
+    hdr->lru_tail[o->cls] = o->prev;
+  o->prev = o->next = 0;
+}
+
+static void lru_push(shm_obj_t *o)
+{
+  uint64_t off = OFF(o);
+
+  o->prev = 0;
+  o->next = hdr->lru_head[o->cls];
+  if (o->next)
+    OBJ(o->next)->prev = off;
+  else
+    hdr->lru_tail[o->cls] = off;
+  hdr->lru_head[o->cls] = off;
+}
+
+static uint64_t find_locked(const char *key)
+{
+  uint64_t off;
+
+  for (off = hdr->buckets[hash_key(key)]; off; off = OBJ(off)->hnext)
+    if (!strcmp(OBJ(off)->bytes, key))
+      return off;
+  return 0;
+}
+
+/* 인덱스/LRU에서 빼고 블록을 등급 free list로 돌려준다 */
+static void unlink_locked(uint64_t off)
+{
+  shm_obj_t *o = OBJ(off);
+  uint64_t *pp = &hdr->buckets[hash_key(o->bytes)];
+
+  while (*pp != off)
+    pp = &OBJ(*pp)->hnext;
+  *pp = o->hnext;
+  lru_unlink(o);
+  o->hnext = hdr->free_head[o->cls];
+  hdr->free_head[o->cls] = off;
+}
+
+/* 세그먼트를 빈 상태로(페이지 배정까지 모두 되돌린다) */
+static void reset_locked(void)
+{
+  memset(hdr->free_head, 0, sizeof(hdr->free_head));
+  memset(hdr->lru_head, 0, sizeof(hdr->lru_head));
+  memset(hdr->lru_tail, 0, sizeof(hdr->lru_tail));
+  memset(hdr->buckets, 0, sizeof(hdr->buckets));
+  hdr->used_pages = 0;
+}
+
+/*
+ * alloc_locked(cls)
+ *  - 등급 free list → 새 페이지 배정 → 같은 등급 LRU 꼬리 퇴출 순서로 블록을 구한다.
+ *  - 모든 페이지가 다른 등급에 배정되어 있고 이 등급에 객체도 없으면 0.
+ */
+static uint64_t alloc_locked(int cls)
+{
+  uint64_t off;
+
+  if (!hdr->free_head[cls] && hdr->used_pages < hdr->npages)
+  {
+    size_t bsize = (size_t)1 << (SHM_MIN_SHIFT + cls);
+    uint64_t page = hdr->pages_off + (uint64_t)hdr->used_pages++ * SHM_PAGE_SIZE;
+
+    for (size_t b = SHM_PAGE_SIZE / bsize; b-- > 0;)
+    {
+      off = page + b * bsize;
+      OBJ(off)->hnext = hdr->free_head[cls];
+      hdr->free_head[cls] = off;
+    }
+  }
+  if (!hdr->free_head[cls] && hdr->lru_tail[cls])
+  {
+    unlink_locked(hdr->lru_tail[cls]);
+    STAT_INC(shm_evicted);
+  }
+  if ((off = hdr->free_head[cls]) != 0)
+    hdr->free_head[cls] = OBJ(off)->hnext;
+  return off;
+}
+
+static void shm_lock(void)
+{
+  int rc = pthread_mutex_lock(&hdr->lock);
+
+  if (rc == EOWNERDEAD)
+  {
+    /* 이전 소유자가 인덱스를 고치다 죽었을 수 있다 — 비우고 다시 일관 상태로 */
+    fprintf(stderr, "shm: lock owner died, clearing the shared cache\n");
+    reset_locked();
+    pthread_mutex_consistent(&hdr->lock);
+  }
+  else if (rc != 0)
+    posix_error(rc, "shm lock");
+}
+
+static void shm_unlock(void)
+{
+  pthread_mutex_unlock(&hdr->lock);
+}
+
+/*
+ * shm_init(name, size)
+ *  - name: shm_open 이름("/proxy-cache" 처럼 '/'로 시작)
+ *  - size: 새로 만들 때의 세그먼트 크기. 이미 있으면 기존 크기를 따른다.
+ */
+void shm_init(const char *name, size_t size)
+{
+  struct stat st;
+  int fd, creator = 0;
+
+  if ((fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600)) >= 0)
+  {
+    creator = 1;
+    if (ftruncate(fd, size) < 0)
+      unix_error("shm: ftruncate error");
+  }
+  else if (errno == EEXIST)
+  {
+    if ((fd = shm_open(name, O_RDWR, 0)) < 0)
+      unix_error("shm: shm_open error");
+    /* 생성자가 아직 ftruncate 전일 수 있다 */
+    for (int i = 0; i < 1000; i++)
+    {
+      if (fstat(fd, &st) < 0)
+        unix_error("shm: fstat error");
+      if (st.st_size > 0)
+        break;
+      usleep(1000);
+    }
+    size = st.st_size;
+  }
+  else
+    unix_error("shm: shm_open error");
+
+  if (size < sizeof(shm_hdr_t) + SHM_PAGE_SIZE)
+  {
+    fprintf(stderr, "shm: %s: segment too small (%zu bytes)\n", name, size);
+    exit(1);
+  }
+  base = Mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  Close(fd);
+  hdr = (shm_hdr_t *)base;
+
+  if (creator)
+  {
+    pthread_mutexattr_t attr;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(&hdr->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    hdr->magic = SHM_MAGIC;
+    hdr->size = size;
+    hdr->hdr_size = sizeof(shm_hdr_t);
+    hdr->obj_size = sizeof(shm_obj_t);
+    hdr->pages_off = (sizeof(shm_hdr_t) + 4095) & ~(uint64_t)4095;
+    hdr->npages = (size - hdr->pages_off) / SHM_PAGE_SIZE;
+    reset_locked();
+    __atomic_store_n(&hdr->ready, 1, __ATOMIC_RELEASE);
+  }
+  else
+  {
+    for (int i = 0; i < 1000 && !__atomic_load_n(&hdr->ready, __ATOMIC_ACQUIRE); i++)
+      usleep(1000);
+    if (!hdr->ready || hdr->magic != SHM_MAGIC || hdr->size != size ||
+        hdr->hdr_size != sizeof(shm_hdr_t) || hdr->obj_size != sizeof(shm_obj_t))
+    {
+      fprintf(stderr, "shm: %s: incompatible segment (remove /dev/shm%s)\n", name, name);
+      exit(1);
+    }
+  }
+  printf("shm: %s %s (%zu MiB, %u pages)\n", creator ? "created" : "attached to",
+         name, size >> 20, hdr->npages);
+}
+
+int shm_enabled(void)
+{
+  return hdr != NULL;
+}
+
+/*
+ * shm_fetch(key)
+ *  - 공유 세그먼트에 key가 있으면 본문과 메타를 복사해 로컬 메모리 캐시에 넣는다.
+ *  - 반환: 올렸으면 1 (호출자는 cache_lookup을 다시 한다), 없으면 0
+ *  - 신선도는 판단하지 않는다 — stale이면 로컬에서 평소처럼 재검증한다.
+ */
+int shm_fetch(const char *key)
+{
+  shm_obj_t *o;
+  cache_meta_t meta;
+  uint64_t off;
+  size_t len;
+  char *data;
+
+  if (!hdr)
+    return 0;
+  shm_lock();
+  if ((off = find_locked(key)) == 0)
+  {
+    shm_unlock();
+    return 0;
+  }
+  o = OBJ(off);
+  lru_unlink(o);
+  lru_push(o);
+  len = o->data_len;
+  data = Malloc(len);
+  memcpy(data, o->bytes + o->key_len + 1, len);
+  meta = o->meta;
+  shm_unlock();
+
+  cache_insert_with(key, data, len, &meta, NULL, 0);
+  STAT_INC(shm_hit);
+  return 1;
+}
+
+/* 원서버에서 새로 받은 객체를 게시(같은 키가 있으면 교체) */
+void shm_store(const char *key, const char *data, size_t size, const cache_meta_t *meta)
+{
+  size_t klen = strlen(key);
+  int cls = size_class(sizeof(shm_obj_t) + klen + 1 + size);
+  shm_obj_t *o;
+  uint64_t off;
+
+  if (!hdr || size > MAX_OBJECT_SIZE || cls < 0)
+    return;
+  shm_lock();
+  if ((off = find_locked(key)) != 0)
+    unlink_locked(off);
+  if ((off = alloc_locked(cls)) == 0)
+  {
+    shm_unlock();
+    return;
+  }
+  o = OBJ(off);
+  o->cls = cls;
+  o->key_len = klen;
+  o->data_len = size;
+  o->meta = *meta;
+  memcpy(o->bytes, key, klen + 1);
+  memcpy(o->bytes + klen + 1, data, size);
+  o->hnext = hdr->buckets[hash_key(key)];
+  hdr->buckets[hash_key(key)] = off;
+  lru_push(o);
+  shm_unlock();
+  STAT_INC(shm_stored);
+}
+
+/*
+ * shm_update_meta(key, meta)
+ *  - 304 재검증 결과를 공유 사본에도 반영한다.
+ *  - 그 사이 다른 프로세스가 더 새 본문을 게시했으면(응답 시각이 재검증 요청보다
+ *    나중) 건드리지 않는다.
+ */
+void shm_update_meta(const char *key, const cache_meta_t *meta)
+{
+  uint64_t off;
+
+  if (!hdr)
+    return;
+  shm_lock();
+  if ((off = find_locked(key)) != 0 && OBJ(off)->meta.response_time <= meta->request_time)
+    OBJ(off)->meta = *meta;
+  shm_unlock();
+}
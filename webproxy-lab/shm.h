@@ -0,0 +1,51 @@
+/*
+ * shm.h — 프로세스 간 공유 캐시 (POSIX 공유 메모리 세그먼트)
+ *
+ * ✅ 왜?
+ *   - 한 호스트에서 proxy 프로세스를 여러 개 띄우면 캐시가 프로세스마다 따로라
+ *     같은 객체를 중복 저장하고, 새로 뜬 프로세스는 빈 캐시로 시작한다.
+ *   - -m <name> 을 주면 같은 이름의 세그먼트(shm_open + mmap)를 모든 프로세스가
+ *     공유한다. 한 프로세스가 받아 온 객체를 다른 프로세스가 바로 쓴다.
+ *
+ * ✅ 구조
+ *   - [shm_hdr_t][페이지 0][페이지 1]...
+ *   - 세그먼트 안의 모든 포인터는 base 기준 오프셋(0 = NULL) — 프로세스마다
+ *     매핑 주소가 달라도 된다.
+ *   - 할당기: SHM_PAGE_SIZE 페이지를 크기 등급(1KiB ~ 128KiB, 2의 거듭제곱)에 하나씩
+ *     배정하고 같은 크기 블록으로 쪼갠다. 등급마다 free list와 LRU를 따로 둔다.
+ *     빈 블록도 새 페이지도 없으면 그 등급의 LRU 꼬리를 퇴출해 재사용한다.
+ *   - 인덱스: 오프셋으로 연결한 해시 체인
+ *
+ * ✅ 락
+ *   - 세그먼트 안의 pthread_mutex_t 하나(PTHREAD_PROCESS_SHARED + ROBUST).
+ *   - 락을 잡은 채 프로세스가 죽으면 다음 잠금이 EOWNERDEAD를 받는다. 그 프로세스가
+ *     인덱스를 고치다 죽었을 수 있으므로 세그먼트를 비우고 계속한다.
+ *   - 본문은 락 안에서 프로세스 로컬 메모리 캐시로 복사해 간다(공유 블록을 락 밖에서
+ *     참조하지 않는다 — 다른 프로세스가 언제든 재사용할 수 있다).
+ *
+ * ✅ 메모리 캐시와의 관계
+ *   - 로컬 미스 → shm_fetch()가 공유 세그먼트에서 찾아 로컬 캐시로 올린다.
+ *   - 원서버에서 새로 받은 객체(cache_insert)는 공유 세그먼트에도 게시하고,
+ *     304 재검증(cache_refresh)은 공유 사본의 메타도 갱신한다.
+ */
+#ifndef __SHM_H__
+#define __SHM_H__
+
+#include "cache.h"
+#include <stdint.h>
+
+#define SHM_DEFAULT_MB 64          /* 세그먼트 기본 크기(MiB), -M 으로 변경 */
+#define SHM_PAGE_SIZE (128 * 1024) /* 페이지 = 가장 큰 블록 */
+#define SHM_MIN_SHIFT 10           /* 가장 작은 블록 1KiB */
+#define SHM_CLASSES 8              /* 1KiB, 2KiB, ... 128KiB */
+#define SHM_BUCKETS 4096
+
+#define SHM_MAGIC 0x50524d31 /* "PRM1" */
+
+void shm_init(const char *name, size_t size);
+int shm_enabled(void);
+int shm_fetch(const char *key);
+void shm_store(const char *key, const char *data, size_t size, const cache_meta_t *meta);
+void shm_update_meta(const char *key, const cache_meta_t *meta);
+
+#endif /* __SHM_H__ */
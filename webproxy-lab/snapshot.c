@@ -0,0 +1,248 @@
+/*
+ * snapshot.c — 메모리 캐시 스냅샷 저장/적재
+ *
+ * ✅ 저장
+ *   - cache_collect()로 엔트리 참조와 메타 복사본을 모아 두고 락 없이 본문을 순서대로 쓴다.
+ *     (참조를 잡고 있으므로 쓰는 동안 퇴출되어도 본문은 살아 있다.
+ *      메타는 갱신과 경합하지 않도록 락 안에서 복사한 것을 쓴다)
+ *   - 인덱스는 dbuf에 모아 본문 뒤에 한 번에 쓰고, 헤더는 마지막에 pwrite로 채운다.
+ *
+ * ✅ 적재
+ *   - 파일 전체를 MAP_PRIVATE / PROT_READ 로 매핑한다.
+ *   - 매핑은 참조 카운트(적재 중 1 + 매핑 본문을 가진 엔트리 수)로 관리하고,
+ *     마지막 엔트리가 해제될 때 munmap 한다. 스냅샷은 시작 시 한 번만 적재하므로
+ *     매핑도 하나뿐이다.
+ */
+#include "snapshot.h"
+#include <sys/mman.h>
+
+static struct
+{
+  char *base;
+  size_t len;
+  int refcnt;
+} snap_map;
+
+static pthread_mutex_t save_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static long elapsed_ms(const struct timespec *t0)
+{
+  struct timespec t1;
+
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  return (t1.tv_sec - t0->tv_sec) * 1000 + (t1.tv_nsec - t0->tv_nsec) / 1000000;
+}
+
+static void map_put(void)
+{
+  if (__atomic_sub_fetch(&snap_map.refcnt, 1, __ATOMIC_ACQ_REL) == 0)
+    munmap(snap_map.base, snap_map.len);
+}
+
+/* 매핑 안의 본문을 가진 엔트리가 해제될 때(cache_release_fn) */
+static void map_release(char *data, size_t size)
+{
+  map_put();
+}
+
+/*
+ * snapshot_save(path)
+ *  - 현재 메모리 캐시를 path에 저장한다. 성공 시 0, 실패 시 -1(이전 파일은 그대로).
+ *  - 주기 저장 스레드와 SIGTERM 저장이 겹치지 않도록 save_lock으로 직렬화한다.
+ */
+int snapshot_save(const char *path)
+{
+  char tmp[MAXLINE];
+  struct timespec t0;
+  snap_hdr_t hdr;
+  snap_rec_t rec;
+  dbuf_t index = {0};
+  cache_entry_t **arr;
+  cache_meta_t *metas;
+  uint64_t off = sizeof(hdr);
+  int fd, n, i, rc = -1;
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  pthread_mutex_lock(&save_lock);
+  snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+  if ((fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+  {
+    fprintf(stderr, "snapshot: %s: %s\n", tmp, strerror(errno));
+    pthread_mutex_unlock(&save_lock);
+    return -1;
+  }
+
+  arr = cache_collect(&n, &metas);
+
+  /* 헤더 자리를 비워 두고 본문부터 쓴다 */
+  if (lseek(fd, sizeof(hdr), SEEK_SET) < 0)
+    goto out;
+  for (i = 0; i < n; i++)
+  {
+    cache_entry_t *e = arr[i];
+
+    if (rio_writen(fd, e->data, e->size) != (ssize_t)e->size)
+      goto out;
+    memset(&rec, 0, sizeof(rec));
+    rec.data_off = off;
+    rec.data_len = e->size;
+    rec.key_len = strlen(e->key);
+    rec.meta = metas[i];
+    dbuf_append(&index, (char *)&rec, sizeof(rec));
+    dbuf_append(&index, e->key, rec.key_len);
+    off += e->size;
+  }
+  if (index.len && rio_writen(fd, index.data, index.len) != (ssize_t)index.len)
+    goto out;
+
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic = SNAPSHOT_MAGIC;
+  hdr.version = SNAPSHOT_VERSION;
+  hdr.count = n;
+  hdr.rec_size = sizeof(snap_rec_t);
+  hdr.index_off = off;
+  hdr.file_len = off + index.len;
+  if (pwrite(fd, &hdr, sizeof(hdr), 0) != sizeof(hdr) || fsync(fd) < 0)
+    goto out;
+  rc = 0;
+
+out:
+  if (close(fd) < 0)
+    rc = -1;
+  if (rc == 0 && rename(tmp, path) < 0)
+    rc = -1;
+  if (rc < 0)
+  {
+    fprintf(stderr, "snapshot: save %s failed: %s\n", path, strerror(errno));
+    unlink(tmp);
+  }
+  else
+    printf("snapshot: saved %d objects (%lu bytes) in %ld ms\n",
+           n, (unsigned long)off - sizeof(hdr), elapsed_ms(&t0));
+
+  for (i = 0; i < n; i++)
+    cache_release(arr[i]);
+  free(arr);
+  free(metas);
+  dbuf_free(&index);
+  pthread_mutex_unlock(&save_lock);
+  return rc;
+}
+
+/*
+ * snapshot_load(path)
+ *  - 시작할 때 한 번, cache_init() 다음에 호출한다.
+ *  - 파일이 없거나 형식이 맞지 않으면 경고만 하고 빈 캐시로 시작한다.
+ *  - 반환: 적재한 엔트리 수(실패 시 -1)
+ */
+int snapshot_load(const char *path)
+{
+  struct timespec t0;
+  struct stat st;
+  snap_hdr_t *hdr;
+  snap_rec_t rec;
+  char key[MAXLINE];
+  time_t now = time(NULL);
+  uint64_t pos;
+  size_t bytes = 0;
+  int fd, loaded = 0, skipped = 0;
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  if ((fd = open(path, O_RDONLY)) < 0)
+  {
+    if (errno != ENOENT)
+      fprintf(stderr, "snapshot: %s: %s\n", path, strerror(errno));
+    return -1;
+  }
+  if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(snap_hdr_t))
+  {
+    fprintf(stderr, "snapshot: %s: too short, ignored\n", path);
+    close(fd);
+    return -1;
+  }
+  snap_map.len = st.st_size;
+  snap_map.base = mmap(NULL, snap_map.len, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (snap_map.base == MAP_FAILED)
+  {
+    fprintf(stderr, "snapshot: mmap %s: %s\n", path, strerror(errno));
+    return -1;
+  }
+
+  hdr = (snap_hdr_t *)snap_map.base;
+  if (hdr->magic != SNAPSHOT_MAGIC || hdr->version != SNAPSHOT_VERSION ||
+      hdr->rec_size != sizeof(snap_rec_t) || hdr->file_len != snap_map.len ||
+      hdr->index_off < sizeof(snap_hdr_t) || hdr->index_off > snap_map.len)
+  {
+    fprintf(stderr, "snapshot: %s: bad header, ignored\n", path);
+    munmap(snap_map.base, snap_map.len);
+    return -1;
+  }
+
+  snap_map.refcnt = 1; /* 적재가 끝날 때까지 잡고 있는 참조 */
+  pos = hdr->index_off;
+  for (uint32_t i = 0; i < hdr->count; i++)
+  {
+    time_t evict_at;
+
+    /* 인덱스만 읽는다 — 본문은 건드리지 않는다 */
+    if (pos + sizeof(rec) > snap_map.len)
+      break;
+    memcpy(&rec, snap_map.base + pos, sizeof(rec));
+    pos += sizeof(rec);
+    if (rec.key_len >= sizeof(key) || pos + rec.key_len > snap_map.len ||
+        rec.data_off < sizeof(snap_hdr_t) || rec.data_len > hdr->index_off ||
+        rec.data_off > hdr->index_off - rec.data_len)
+      break;
+    memcpy(key, snap_map.base + pos, rec.key_len);
+    key[rec.key_len] = '\0';
+    pos += rec.key_len;
+
+    /* 꺼져 있던 동안 쓸모없어진 엔트리는 버리되, 검증자가 있으면 재검증용으로 남긴다 */
+    evict_at = cache_evict_time(&rec.meta);
+    if (evict_at <= now)
+    {
+      if (!rec.meta.etag[0] && !rec.meta.last_modified[0])
+      {
+        skipped++;
+        continue;
+      }
+      evict_at = now + CACHE_REVALIDATE_GRACE;
+    }
+
+    __atomic_add_fetch(&snap_map.refcnt, 1, __ATOMIC_ACQ_REL);
+    cache_insert_with(key, snap_map.base + rec.data_off, rec.data_len, &rec.meta,
+                      map_release, evict_at);
+    loaded++;
+    bytes += rec.data_len;
+  }
+
+  printf("snapshot: loaded %d objects (%zu bytes, %d expired) in %ld ms\n",
+         loaded, bytes, skipped, elapsed_ms(&t0));
+  map_put();
+  return loaded;
+}
+
+/* -S <초>: 주기 저장 스레드 */
+static const char *snap_path;
+static int snap_interval;
+
+static void *snapshot_thread(void *vargp)
+{
+  Pthread_detach(pthread_self());
+  while (1)
+  {
+    sleep(snap_interval);
+    snapshot_save(snap_path);
+  }
+  return NULL;
+}
+
+void snapshot_start(const char *path, int interval)
+{
+  pthread_t tid;
+
+  snap_path = path;
+  snap_interval = interval;
+  Pthread_create(&tid, NULL, snapshot_thread, NULL);
+}
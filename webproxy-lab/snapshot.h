@@ -0,0 +1,49 @@
+/*
+ * snapshot.h — 메모리 캐시 스냅샷 (재시작 후 warm start)
+ *
+ * ✅ 동작
+ *   - snapshot_save(): 메모리 캐시의 엔트리 전부를 파일 하나로 내린다.
+ *     SIGTERM을 받았을 때, 그리고 -S <초> 를 주면 주기적으로 저장한다.
+ *     임시 파일에 다 쓴 뒤 rename() 하므로 도중에 죽어도 이전 스냅샷이 남는다.
+ *   - snapshot_load(): 시작할 때 파일을 mmap하고 인덱스만 훑어 캐시에 넣는다.
+ *     본문은 복사하지도 파싱하지도 않는다 — 엔트리의 data가 매핑 안을 가리킨다.
+ *   - 신선도는 저장된 메타 그대로다. 만료된 엔트리도 검증자가 있으면 남겨 두고
+ *     첫 요청 때 평소처럼 조건부 재검증(304)을 받는다(lazy validation).
+ *
+ * ✅ 파일 형식
+ *   [snap_hdr_t][본문 0][본문 1]...[snap_rec_t + 키][snap_rec_t + 키]...
+ *     - index_off: 첫 snap_rec_t 위치, 레코드는 LRU 오래된 순서
+ */
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+
+#include "cache.h"
+#include <stdint.h>
+
+#define SNAPSHOT_MAGIC 0x50525331 /* "PRS1" */
+#define SNAPSHOT_VERSION 3
+
+typedef struct
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t count;     /* 엔트리 수 */
+  uint32_t rec_size;  /* sizeof(snap_rec_t) — 빌드가 달라졌는지 확인용 */
+  uint64_t index_off; /* 인덱스 시작 오프셋 */
+  uint64_t file_len;  /* 파일 전체 길이(잘린 파일 감지) */
+} snap_hdr_t;
+
+typedef struct
+{
+  uint64_t data_off; /* 본문 시작 오프셋 */
+  uint64_t data_len;
+  uint32_t key_len; /* 레코드 뒤에 이어지는 키 바이트 수(NUL 없음) */
+  uint32_t pad;
+  cache_meta_t meta;
+} snap_rec_t;
+
+int snapshot_save(const char *path);
+int snapshot_load(const char *path);
+void snapshot_start(const char *path, int interval);
+
+#endif /* __SNAPSHOT_H__ */
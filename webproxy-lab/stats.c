@@ -0,0 +1,46 @@
+/*
+ * stats.c — 프록시 동작 카운터 출력
+ */
+#include "stats.h"
+
+proxy_stats_t proxy_stats;
+
+#define LOAD(f) __atomic_load_n(&proxy_stats.f, __ATOMIC_RELAXED)
+#define DUMP(f) fprintf(fp, "  %-24s %ld\n", #f, LOAD(f))
+
+void stats_dump(FILE *fp)
+{
+  fprintf(fp, "=== proxy stats ===\n");
+  DUMP(cache_hit);
+  DUMP(fast_hit);
+  DUMP(cache_miss);
+  DUMP(revalidated);
+  DUMP(cache_bypass_large);
+  DUMP(vary_evicted);
+  DUMP(range_hit);
+  DUMP(range_not_satisfiable);
+  DUMP(range_whole);
+  DUMP(neg_hit);
+  DUMP(neg_stored);
+  DUMP(stale_while_revalidate);
+  DUMP(stale_if_error);
+  DUMP(refresh_queued);
+  DUMP(refresh_dropped);
+  DUMP(refresh_304);
+  DUMP(refresh_200);
+  DUMP(refresh_error);
+  DUMP(janitor_sweeps);
+  DUMP(janitor_evicted);
+  DUMP(janitor_bytes);
+  DUMP(disk_hit);
+  DUMP(disk_stored);
+  DUMP(disk_dropped_segs);
+  DUMP(disk_compactions);
+  DUMP(disk_compacted_bytes);
+  DUMP(shm_hit);
+  DUMP(shm_stored);
+  DUMP(shm_evicted);
+  DUMP(splice_bytes);
+  DUMP(origin_truncated);
+  fflush(fp);
+}
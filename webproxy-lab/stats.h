@@ -0,0 +1,69 @@
+/*
+ * stats.h — 프록시 동작 카운터
+ *
+ * ✅ 사용법
+ *   - 어디서든 STAT_INC(필드) / STAT_ADD(필드, n) 로 올린다(원자적, 락 없음).
+ *   - SIGUSR1을 보내면 signal 스레드가 stats_dump()로 현재 값을 출력한다.
+ *       kill -USR1 <proxy pid>
+ */
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include "csapp.h"
+
+typedef struct
+{
+  /* 캐시 조회 */
+  long cache_hit;         /* fresh 히트 */
+  long fast_hit;          /* 그중 요청 헤더를 읽기 전에 응답한 히트 */
+  long cache_miss;        /* 엔트리 없음 */
+  long revalidated;       /* 포그라운드 재검증 → 304 */
+  long cache_bypass_large; /* Content-Length만 보고 MAX_OBJECT_SIZE 초과로 판단 */
+  long vary_evicted;      /* URL당 변형 수 상한으로 밀려난 변형 */
+  long range_hit;         /* 캐시 본문에서 자른 206 */
+  long range_not_satisfiable; /* 416 */
+  long range_whole;       /* -r: Range 미스를 전체 객체 요청으로 바꿈 */
+  long neg_hit;           /* 최근 실패한 원서버 — 연결 시도 없이 502 */
+  long neg_stored;        /* 기억한 DNS/연결 실패 */
+
+  /* stale 응답 (RFC 5861) */
+  long stale_while_revalidate; /* 만료 본문을 즉시 주고 갱신 예약 */
+  long stale_if_error;         /* 원서버 오류 대신 만료 본문 */
+
+  /* 백그라운드 갱신 결과 */
+  long refresh_queued;
+  long refresh_dropped;   /* 큐가 가득 차서 예약 못 함 */
+  long refresh_304;       /* 재검증 성공(본문 재사용) */
+  long refresh_200;       /* 새 본문으로 교체 */
+  long refresh_error;     /* 접속 실패 / 5xx / 저장 불가 응답 */
+
+  /* janitor(만료 인덱스) */
+  long janitor_sweeps;    /* 뭔가를 퇴출한 sweep 수 */
+  long janitor_evicted;
+  long janitor_bytes;
+
+  /* 디스크 2차 캐시 */
+  long disk_hit;
+  long disk_stored;          /* 메모리에서 밀려나 디스크에 기록 */
+  long disk_dropped_segs;    /* 용량 상한으로 버린 세그먼트 */
+  long disk_compactions;
+  long disk_compacted_bytes; /* compaction으로 회수한 바이트 */
+
+  /* 프로세스 간 공유 캐시 */
+  long shm_hit;     /* 로컬 미스 → 공유 세그먼트에서 가져옴 */
+  long shm_stored;
+  long shm_evicted; /* 블록이 모자라 공유 LRU에서 퇴출 */
+
+  /* splice 중계 */
+  long splice_bytes; /* 유저 공간을 거치지 않고 중계한 본문 바이트 */
+  long origin_truncated; /* 프레이밍(Content-Length/chunked)보다 일찍 끊긴 응답 */
+} proxy_stats_t;
+
+extern proxy_stats_t proxy_stats;
+
+#define STAT_ADD(f, n) __atomic_add_fetch(&proxy_stats.f, (n), __ATOMIC_RELAXED)
+#define STAT_INC(f) STAT_ADD(f, 1)
+
+void stats_dump(FILE *fp);
+
+#endif /* __STATS_H__ */
@@ -1,41 +1,136 @@
 /*
  * adder.c - a minimal CGI program that adds two numbers together
+ *
+ * Run by tiny with TINY_CGI_LOOP set (tiny -c N), it stays resident and
+ * answers framed requests on stdin/stdout instead (see ../cgipool.h).
+ * Built with -DTINY_HANDLER it is a shared object whose handle() tiny
+ * calls in-process (see ../handler.h).
  */
 /* $begin adder */
 #include "csapp.h"
+#include "cgipool.h"
+#include "handler.h"
 
-int main(void)
+/*
+ * add - build the CGI output for query into out (n bytes); returns its
+ *     length, or -1 if the query is too long for the page or out
+ */
+static int add(char *query, char *out, size_t n)
 {
-  char *buf, *p;
-  char arg1[MAXLINE], arg2[MAXLINE], content[MAXLINE];
-  int n1 = 0, n2 = 0;
+  char *p, arg1[MAXLINE], arg2[MAXLINE], content[MAXLINE];
+  int n1 = 0, n2 = 0, len;
+
+  if (query != NULL && strlen(query) >= MAXLINE)
+    return -1;
 
   /* Extract the two arguments */
-  if ((buf = getenv("QUERY_STRING")) != NULL)
+  if (query != NULL && (p = strchr(query, '&')) != NULL)
   {
-    p = strchr(buf, '&');
     *p = '\0';
-    strcpy(arg1, buf);
+    strcpy(arg1, query);
     strcpy(arg2, p + 1);
-    n1 = atoi(strchr(arg1, '=') + 1);
-    n2 = atoi(strchr(arg2, '=') + 1);
+    n1 = atoi(strchr(arg1, '=') ? strchr(arg1, '=') + 1 : arg1);
+    n2 = atoi(strchr(arg2, '=') ? strchr(arg2, '=') + 1 : arg2);
   }
 
   /* Make the response body */
-  sprintf(content, "QUERY_STRING=%s\r\n<p>", buf);
-  sprintf(content + strlen(content), "Welcome to add.com: ");
-  sprintf(content + strlen(content), "THE Internet addition portal.\r\n<p>");
-  sprintf(content + strlen(content), "The answer is: %d + %d = %d\r\n<p>",
-          n1, n2, n1 + n2);
-  sprintf(content + strlen(content), "Thanks for visiting!\r\n");
+  len = snprintf(content, sizeof(content),
+                 "QUERY_STRING=%s\r\n<p>"
+                 "Welcome to add.com: "
+                 "THE Internet addition portal.\r\n<p>"
+                 "The answer is: %d + %d = %d\r\n<p>"
+                 "Thanks for visiting!\r\n",
+                 query, n1, n2, n1 + n2);
+  if (len < 0 || (size_t)len >= sizeof(content))
+    return -1;
 
   /* Generate the HTTP response */
-  printf("Content-type: text/html\r\n");
-  printf("Content-length: %d\r\n", (int)strlen(content));
-  printf("\r\n");
-  printf("%s", content);
+  len = snprintf(out, n, "Content-type: text/html\r\n"
+                         "Content-length: %d\r\n\r\n%s",
+                 len, content);
+  if (len < 0 || (size_t)len >= n)
+    return -1;
+  return len;
+}
+
+#ifdef TINY_HANDLER
+/* handle - tiny's in-process entry point */
+int handle(const char *query, char *out, size_t n)
+{
+  char q[MAXLINE];
+
+  if (strlen(query) >= sizeof(q))
+    return -1;
+  strcpy(q, query);
+  return add(q, out, n);
+}
+#else
+/* Sent instead of the page when add() can't fit it */
+static const char toolong[] = "Content-type: text/html\r\n"
+                              "Content-length: 20\r\n\r\n"
+                              "Query is too long.\r\n";
+
+/* read or write exactly n bytes; -1 on error or EOF */
+static int xfer(int fd, char *buf, size_t n, int out)
+{
+  while (n > 0)
+  {
+    ssize_t rc = out ? write(fd, buf, n) : read(fd, buf, n);
+
+    if (rc < 0 && errno == EINTR)
+      continue;
+    if (rc <= 0)
+      return -1;
+    buf += rc;
+    n -= rc;
+  }
+  return 0;
+}
+
+/* loop - serve framed requests from tiny until it closes the socket */
+static void loop(void)
+{
+  char query[MAXLINE], out[2 * MAXLINE];
+  uint32_t len;
+  int rc;
+
+  if (xfer(STDOUT_FILENO, CGI_MAGIC, 4, 1) < 0)
+    return;
+  while (xfer(STDIN_FILENO, (char *)&len, 4, 0) == 0)
+  {
+    if ((len = ntohl(len)) >= sizeof(query) ||
+        xfer(STDIN_FILENO, query, len, 0) < 0)
+      return;
+    query[len] = '\0';
+    if ((rc = add(query, out + 4, sizeof(out) - 4)) < 0)
+    { /* Too long for the page: answer with a short notice instead */
+      memcpy(out + 4, toolong, sizeof(toolong) - 1);
+      rc = sizeof(toolong) - 1;
+    }
+    len = rc;
+    *(uint32_t *)out = htonl(len);
+    if (xfer(STDOUT_FILENO, out, len + 4, 1) < 0)
+      return;
+  }
+}
+
+int main(void)
+{
+  char out[2 * MAXLINE];
+  int len;
+
+  if (getenv(CGI_LOOP_ENV))
+  {
+    loop();
+    exit(0);
+  }
+  if ((len = add(getenv("QUERY_STRING"), out, sizeof(out))) < 0)
+    printf("%s", toolong);
+  else
+    printf("%.*s", len, out);
   fflush(stdout);
 
   exit(0);
 }
+#endif
 /* $end adder */
@@ -0,0 +1,173 @@
+/*
+ * cgipool.c - persistent CGI worker processes (tiny -c N)
+ */
+#include "cgipool.h"
+#include "sbuf.h"
+#include <sys/syscall.h>
+
+typedef struct cgi_pool
+{
+  char *path;
+  int loop;       /* 1: workers running, 0: program has no loop mode */
+  pid_t *pid;     /* per worker slot */
+  int *fd;        /* tiny's end of the slot's socketpair, -1 if dead */
+  sbuf_t idle;    /* slots waiting for a request */
+  struct cgi_pool *next;
+} cgi_pool_t;
+
+static int nworkers; /* 0: pool disabled */
+static cgi_pool_t *pools;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* enable the pool with n workers per CGI program */
+void cgipool_init(int n)
+{
+  nworkers = n;
+}
+
+/* read exactly n bytes; -1 on error or early EOF */
+static int read_full(int fd, void *buf, size_t n)
+{
+  return rio_readn(fd, buf, n) == (ssize_t)n ? 0 : -1;
+}
+
+/* kill and reap the worker in slot i, if any */
+static void stop(cgi_pool_t *p, int i)
+{
+  if (p->fd[i] >= 0)
+    close(p->fd[i]);
+  if (p->pid[i] > 0)
+  {
+    kill(p->pid[i], SIGKILL);
+    waitpid(p->pid[i], NULL, 0);
+  }
+  p->fd[i] = p->pid[i] = -1;
+}
+
+/* start worker slot i of p; -1 if it did not say CGI_MAGIC in time */
+static int spawn(cgi_pool_t *p, int i)
+{
+  struct timeval tv = {CGI_HELLO_SECS, 0}, none = {0, 0};
+  char *argv[] = {p->path, NULL}, hello[4];
+  int sv[2];
+
+  if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) < 0)
+    return -1;
+  if ((p->pid[i] = Fork()) == 0)
+  { /* Child: the socket is stdin and stdout, then run the program.
+       Close everything else so it can't hold client connections open. */
+    Dup2(sv[1], STDIN_FILENO);
+    Dup2(sv[1], STDOUT_FILENO);
+    if (syscall(SYS_close_range, 3, ~0U, 0) < 0)
+      for (int f = 3; f < 1024; f++)
+        close(f);
+    setenv(CGI_LOOP_ENV, "1", 1);
+    Execve(p->path, argv, environ);
+  }
+  close(sv[1]);
+  p->fd[i] = sv[0];
+  setsockopt(sv[0], SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  if (read_full(sv[0], hello, 4) < 0 || memcmp(hello, CGI_MAGIC, 4))
+  {
+    stop(p, i);
+    return -1;
+  }
+  setsockopt(sv[0], SOL_SOCKET, SO_RCVTIMEO, &none, sizeof(none));
+  return 0;
+}
+
+/* replace a worker that died or broke the protocol */
+static void respawn(cgi_pool_t *p, int i)
+{
+  stop(p, i);
+  spawn(p, i);
+}
+
+/* pool for path, started on first use (lock held) */
+static cgi_pool_t *get_pool_locked(const char *path)
+{
+  cgi_pool_t *p;
+
+  for (p = pools; p; p = p->next)
+    if (!strcmp(p->path, path))
+      return p;
+
+  p = Calloc(1, sizeof(*p));
+  p->path = strdup(path);
+  p->pid = Calloc(nworkers, sizeof(*p->pid));
+  p->fd = Calloc(nworkers, sizeof(*p->fd));
+  p->loop = 1;
+  sbuf_init(&p->idle, nworkers);
+  for (int i = 0; i < nworkers; i++)
+    p->fd[i] = p->pid[i] = -1;
+  for (int i = 0; i < nworkers && p->loop; i++)
+    if (spawn(p, i) < 0)
+      p->loop = 0;
+  for (int i = 0; i < nworkers; i++)
+    if (p->loop)
+      sbuf_insert(&p->idle, i);
+    else
+      stop(p, i);
+  p->next = pools;
+  pools = p;
+  return p;
+}
+
+/* one request/response round trip on worker slot i; response in *out */
+static ssize_t round_trip(cgi_pool_t *p, int i, char *cgiargs, char **out)
+{
+  uint32_t len = htonl(strlen(cgiargs));
+  struct iovec iov[2] = {{&len, 4}, {cgiargs, strlen(cgiargs)}};
+  size_t n;
+
+  if (p->fd[i] < 0 || send_vec(p->fd[i], iov, 2, 0) < 0)
+    return -1;
+  if (read_full(p->fd[i], &len, 4) < 0 || (n = ntohl(len)) > CGI_MAX_FRAME)
+    return -1;
+  *out = Malloc(n + 1);
+  if (read_full(p->fd[i], *out, n) < 0)
+  {
+    free(*out);
+    return -1;
+  }
+  return n;
+}
+
+/*
+ * cgipool_serve - run filename?cgiargs on a pooled worker and send the
+ *     response. Returns -1, having sent nothing, when the pool is off or
+ *     the program has no loop mode; the caller then forks as before.
+ */
+int cgipool_serve(int fd, char *filename, char *cgiargs)
+{
+  cgi_pool_t *p;
+  char *out;
+  ssize_t n;
+  int i;
+
+  if (!nworkers || strlen(cgiargs) > CGI_MAX_FRAME)
+    return -1;
+  pthread_mutex_lock(&lock);
+  p = get_pool_locked(filename);
+  pthread_mutex_unlock(&lock);
+  if (!p->loop)
+    return -1;
+
+  i = sbuf_remove(&p->idle);
+  if ((n = round_trip(p, i, cgiargs, &out)) < 0)
+  { /* Worker died or garbled a frame: replace it and retry once */
+    respawn(p, i);
+    n = round_trip(p, i, cgiargs, &out);
+  }
+  sbuf_insert(&p->idle, i);
+  if (n < 0)
+  {
+    clienterror(fd, filename, "502", "Bad gateway",
+                "Tiny’s CGI worker failed");
+    return 0;
+  }
+  if (send_cgi(fd, out, n) < 0)
+    fprintf(stderr, "cgipool_serve: write error: %s\n", strerror(errno));
+  free(out);
+  return 0;
+}
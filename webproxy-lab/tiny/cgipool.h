@@ -0,0 +1,33 @@
+/*
+ * cgipool.h - persistent CGI worker processes (tiny -c N)
+ *
+ * Instead of fork/exec per request, tiny starts N long-lived copies of a
+ * CGI program the first time it is requested and keeps them on a
+ * socketpair each (the worker's stdin and stdout). Programs opt in by
+ * checking CGI_LOOP_ENV; anything else falls back to serve_dynamic().
+ *
+ * Protocol, all lengths 4-byte big-endian:
+ *   worker -> tiny  CGI_MAGIC once at startup
+ *   tiny -> worker  length + QUERY_STRING
+ *   worker -> tiny  length + CGI output (header lines, blank line, body)
+ */
+#ifndef __CGIPOOL_H__
+#define __CGIPOOL_H__
+
+#include "csapp.h"
+
+#define CGI_LOOP_ENV "TINY_CGI_LOOP" /* set in the worker's environment */
+#define CGI_MAGIC "TCG1"             /* 4-byte hello from a loop-mode worker */
+#define CGI_MAX_FRAME (1 << 20)      /* largest frame either side accepts */
+#define CGI_HELLO_SECS 1             /* wait this long for CGI_MAGIC */
+
+void cgipool_init(int nworkers);
+int cgipool_serve(int fd, char *filename, char *cgiargs);
+
+/* tiny.c */
+void clienterror(int fd, char *cause, char *errnum, char *shortmsg,
+                 char *longmsg);
+ssize_t send_vec(int fd, struct iovec *iov, int iovcnt, int flags);
+ssize_t send_cgi(int fd, char *out, size_t n);
+
+#endif /* __CGIPOOL_H__ */
@@ -0,0 +1,157 @@
+/*
+ * fcache.c - open-file cache for tiny's static content
+ */
+#include "fcache.h"
+
+static fent_t *buckets[FCACHE_BUCKETS];
+static int nent;
+static unsigned long clock_;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static unsigned hash(const char *s)
+{
+  unsigned h = 5381;
+
+  while (*s)
+    h = h * 33 + (unsigned char)*s++;
+  return h % FCACHE_BUCKETS;
+}
+
+static void release(fent_t *e)
+{
+  if (--e->refcnt == 0)
+  {
+    close(e->fd);
+    free(e->path);
+    free(e);
+  }
+}
+
+/* unlink e from its chain and drop the table's reference (lock held) */
+static void drop(fent_t *e)
+{
+  fent_t **pp = &buckets[hash(e->path)];
+
+  while (*pp != e)
+    pp = &(*pp)->next;
+  *pp = e->next;
+  nent--;
+  release(e);
+}
+
+/* evict the least recently used entry (lock held) */
+static void evict_lru(void)
+{
+  fent_t *e, *victim = NULL;
+
+  for (int i = 0; i < FCACHE_BUCKETS; i++)
+    for (e = buckets[i]; e; e = e->next)
+      if (!victim || e->used < victim->used)
+        victim = e;
+  if (victim)
+    drop(victim);
+}
+
+/*
+ * load - stat and open path, build its response header. Size, inode and
+ *     mtime come from the opened fd, so they describe the file it sends.
+ *     Returns NULL with *status set to 404 or 403 on failure.
+ */
+static fent_t *load(const char *path, int *status)
+{
+  struct stat sbuf;
+  fent_t *e;
+  int fd;
+
+  if (stat(path, &sbuf) < 0)
+  {
+    *status = 404;
+    return NULL;
+  }
+  if (!S_ISREG(sbuf.st_mode) || !(S_IRUSR & sbuf.st_mode) ||
+      (fd = open(path, O_RDONLY | O_CLOEXEC)) < 0)
+  {
+    *status = 403;
+    return NULL;
+  }
+  if (fstat(fd, &sbuf) < 0 || !S_ISREG(sbuf.st_mode))
+  { /* Replaced since the stat() */
+    close(fd);
+    *status = 403;
+    return NULL;
+  }
+
+  e = Calloc(1, sizeof(*e));
+  e->path = strdup(path);
+  e->fd = fd;
+  e->size = sbuf.st_size;
+  e->ino = sbuf.st_ino;
+  e->mtime = sbuf.st_mtime;
+  e->checked = time(NULL);
+  e->refcnt = 1;
+  get_filetype(e->path, e->filetype);
+  make_etag(e->etag, e->ino, e->size, e->mtime, 0);
+  e->hdr_len = static_header(e->hdr, sizeof(e->hdr), e->size, e->filetype,
+                             e->etag, e->mtime);
+  return e;
+}
+
+/* stat() again if the entry is due; 1 if the file is unchanged */
+static int still_valid(fent_t *e, time_t now)
+{
+  struct stat sbuf;
+
+  if (now - e->checked < FCACHE_RECHECK)
+    return 1;
+  if (stat(e->path, &sbuf) < 0 || sbuf.st_ino != e->ino ||
+      sbuf.st_size != e->size || sbuf.st_mtime != e->mtime)
+    return 0;
+  e->checked = now;
+  return 1;
+}
+
+/*
+ * fcache_get - return a referenced entry for path, loading it on a miss.
+ *     Returns NULL with *status = 404 (missing) or 403 (not a readable
+ *     regular file). Release the entry with fcache_put().
+ */
+fent_t *fcache_get(const char *path, int *status)
+{
+  unsigned h = hash(path);
+  time_t now = time(NULL);
+  fent_t *e;
+
+  pthread_mutex_lock(&lock);
+  for (e = buckets[h]; e; e = e->next)
+    if (!strcmp(e->path, path))
+      break;
+  if (e && !still_valid(e, now))
+  {
+    drop(e);
+    e = NULL;
+  }
+  if (!e)
+  {
+    if ((e = load(path, status)) == NULL)
+    {
+      pthread_mutex_unlock(&lock);
+      return NULL;
+    }
+    if (nent >= FCACHE_MAX)
+      evict_lru();
+    e->next = buckets[h];
+    buckets[h] = e;
+    nent++;
+  }
+  e->used = ++clock_;
+  e->refcnt++;
+  pthread_mutex_unlock(&lock);
+  return e;
+}
+
+void fcache_put(fent_t *e)
+{
+  pthread_mutex_lock(&lock);
+  release(e);
+  pthread_mutex_unlock(&lock);
+}
@@ -0,0 +1,50 @@
+/*
+ * fcache.h - open-file cache for tiny's static content
+ *
+ * Keeps an open fd, the stat result and the prebuilt response header for
+ * up to FCACHE_MAX hot files, keyed by path. A hit is one hash lookup;
+ * the body then goes out with a single sendfile() from the cached fd.
+ *
+ * Entries are rechecked with stat() at most every FCACHE_RECHECK seconds.
+ * If the inode, size or mtime changed, the entry is reloaded. Entries are
+ * reference counted so an evicted or reloaded file stays open until the
+ * last request using it is done.
+ */
+#ifndef __FCACHE_H__
+#define __FCACHE_H__
+
+#include "csapp.h"
+
+#define FCACHE_MAX 64     /* cached files */
+#define FCACHE_BUCKETS 128
+#define FCACHE_RECHECK 1  /* seconds between stat() rechecks of an entry */
+#define ETAG_LEN 64       /* make_etag() result, quotes included */
+
+typedef struct fent
+{
+  char *path;
+  int fd;
+  off_t size;
+  ino_t ino;
+  time_t mtime;
+  char filetype[64];      /* get_filetype() result */
+  char etag[ETAG_LEN];   /* make_etag() of ino/size/mtime */
+  char hdr[MAXLINE];     /* static_header() result: status line and fields */
+  size_t hdr_len;
+
+  time_t checked;        /* last stat() */
+  unsigned long used;    /* LRU stamp */
+  int refcnt;            /* 1 for the table + 1 per request in flight */
+  struct fent *next;     /* hash chain */
+} fent_t;
+
+fent_t *fcache_get(const char *path, int *status);
+void fcache_put(fent_t *e);
+
+/* tiny.c */
+void get_filetype(char *filename, char *filetype);
+void make_etag(char *etag, ino_t ino, off_t size, time_t mtime, int gzip);
+size_t static_header(char *buf, size_t n, off_t size, char *filetype,
+                     char *etag, time_t mtime);
+
+#endif /* __FCACHE_H__ */
@@ -0,0 +1,216 @@
+/*
+ * gen.c - synthetic responses for proxy benchmarking (GET /gen?...)
+ */
+#include "gen.h"
+#include <limits.h>
+
+static char pattern[GEN_PATTERN];
+static pthread_once_t pattern_once = PTHREAD_ONCE_INIT;
+
+/* 64-byte lines of printable text, so bodies are easy to eyeball */
+static void pattern_init(void)
+{
+  static const char digits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+
+  for (int i = 0; i < GEN_PATTERN; i++)
+    pattern[i] = i % 64 == 63 ? '\n' : digits[(i / 64 + i % 64) % 36];
+}
+
+/* 1 if uri names the generator: "/gen" or "/gen?..." */
+int gen_path(const char *uri)
+{
+  return !strncmp(uri, "/gen", 4) && (uri[4] == '\0' || uri[4] == '?');
+}
+
+/*
+ * copy the %XX-decoded value of name from query into val; 0 if absent,
+ * -1 if it decodes to a control character (it may end up in a header)
+ */
+static int param(const char *query, const char *name, char *val, size_t n)
+{
+  size_t len = strlen(name), i = 0;
+  const char *p = query;
+
+  while (p && *p)
+  {
+    if (!strncmp(p, name, len) && p[len] == '=')
+    {
+      for (p += len + 1; *p && *p != '&' && i + 1 < n; p++)
+      {
+        unsigned c;
+
+        if (*p == '%' && sscanf(p + 1, "%2x", &c) == 1)
+          p += 2;
+        else
+          c = *p == '+' ? ' ' : (unsigned char)*p;
+        if (c < 0x20 || c == 0x7f)
+          return -1;
+        val[i++] = c;
+      }
+      val[i] = '\0';
+      return 1;
+    }
+    if ((p = strchr(p, '&')) != NULL)
+      p++;
+  }
+  return 0;
+}
+
+/* the value of name as a number in [0, max]; dflt if absent, -1 if not */
+static long long param_num(const char *query, const char *name, long long dflt,
+                           long long max)
+{
+  char val[32], *end;
+  long long v;
+  int rc;
+
+  if ((rc = param(query, name, val, sizeof(val))) <= 0)
+    return rc < 0 ? -1 : dflt;
+  errno = 0;
+  v = strtoll(val, &end, 10);
+  return end == val || *end || errno || v < 0 || v > max ? -1 : v;
+}
+
+static void sleep_ms(long ms)
+{
+  struct timespec ts = {ms / 1000, (ms % 1000) * 1000000L};
+
+  while (nanosleep(&ts, &ts) < 0 && errno == EINTR)
+    ;
+}
+
+/* wait for the client to hang up, ignoring whatever it sends */
+static void hang(int fd)
+{
+  char buf[512];
+  ssize_t rc;
+
+  while ((rc = read(fd, buf, sizeof(buf))) != 0)
+    if (rc < 0 && errno != EAGAIN && errno != EINTR)
+      break;
+}
+
+/* send body bytes [off, off + n) of the pattern, as one chunk if chunked */
+static int send_slice(int fd, long long off, size_t n, int chunked, int flags)
+{
+  char head[32];
+  struct iovec iov[3];
+  int cnt = 0;
+
+  if (chunked)
+  {
+    iov[cnt].iov_base = head;
+    iov[cnt++].iov_len = sprintf(head, "%zx\r\n", n);
+  }
+  iov[cnt].iov_base = pattern + off % GEN_PATTERN;
+  iov[cnt++].iov_len = n;
+  if (chunked)
+  {
+    iov[cnt].iov_base = "\r\n";
+    iov[cnt++].iov_len = 2;
+  }
+  return send_vec(fd, iov, cnt, flags) < 0 ? -1 : 0;
+}
+
+/*
+ * gen_serve - answer GET uri (a gen_path()) as its query asks. eoh ends
+ *     the header when the response can leave the connection open; http11
+ *     is set for HTTP/1.1 requests, the only ones that get chunks.
+ *     Returns 1 if it left the connection open.
+ */
+int gen_serve(int fd, char *uri, char *eoh, int http11)
+{
+  char *query = uri[4] == '?' ? uri + 5 : "", cache[MAXLINE], hdr[2 * MAXLINE];
+  long long size = param_num(query, "size", GEN_SIZE, LLONG_MAX);
+  long long truncate = param_num(query, "truncate", LLONG_MAX, LLONG_MAX);
+  long long bps = param_num(query, "trickle_bps", 0, LLONG_MAX);
+  long long delay = param_num(query, "delay_ms", 0, LONG_MAX);
+  long long forever = param_num(query, "forever", 0, LLONG_MAX);
+  long long chunked = param_num(query, "chunked", 0, LLONG_MAX);
+  long long stall = param_num(query, "hang", 0, LLONG_MAX);
+  int has_cache = param(query, "cache", cache, sizeof(cache));
+  long long off, end, tick, left;
+  size_t len = 0, n;
+  int more, keep, close_delim;
+
+  if (size < 0 || truncate < 0 || bps < 0 || delay < 0 || forever < 0 ||
+      chunked < 0 || stall < 0 || has_cache < 0)
+  {
+    clienterror(fd, "/gen", "400", "Bad request",
+                "Tiny couldn’t parse the generator parameters");
+    return 0;
+  }
+  pthread_once(&pattern_once, pattern_init);
+  if (stall)
+  {
+    hang(fd);
+    return 0;
+  }
+  /* An HTTP/1.0 client can't take chunks: end the body by closing instead */
+  chunked = forever || chunked;
+  close_delim = chunked && !http11;
+  if (close_delim)
+    chunked = 0;
+  keep = strcmp(eoh, "Connection: close\r\n\r\n") && !forever &&
+         !close_delim && truncate >= size;
+  sleep_ms(delay);
+
+  len += snprintf(hdr + len, sizeof(hdr) - len,
+                  "HTTP/1.1 200 OK\r\n"
+                  "Server: Tiny Web Server\r\n"
+                  "Content-type: text/plain\r\n");
+  if (chunked)
+    len += snprintf(hdr + len, sizeof(hdr) - len, "Transfer-Encoding: chunked\r\n");
+  else if (!close_delim)
+    len += snprintf(hdr + len, sizeof(hdr) - len, "Content-length: %lld\r\n", size);
+  if (has_cache)
+    len += snprintf(hdr + len, sizeof(hdr) - len, "Cache-Control: %s\r\n", cache);
+  len += snprintf(hdr + len, sizeof(hdr) - len, "%s",
+                  keep ? eoh : "Connection: close\r\n\r\n");
+  if (len >= sizeof(hdr))
+    return 0;
+
+  /* Body: pattern slices up to its end; when trickling, as many as make
+     up bps * GEN_TICK_MS / 1000 bytes, then a pause of GEN_TICK_MS. Hold
+     back (MSG_MORE) all but the last send unless pacing. */
+  if (bps == 0)
+    tick = LLONG_MAX;
+  else if (bps > LLONG_MAX / GEN_TICK_MS)
+    tick = bps / 1000 * GEN_TICK_MS;
+  else
+    tick = bps * GEN_TICK_MS / 1000;
+  if (tick == 0)
+    tick = 1;
+  end = truncate < size ? truncate : size;
+  more = bps == 0 && (chunked || end > 0) ? MSG_MORE : 0;
+  struct iovec iov = {hdr, len};
+  if (send_vec(fd, &iov, 1, more) < 0)
+    return 0;
+  for (off = 0, left = tick; forever || off < end; off += n)
+  {
+    n = GEN_PATTERN - off % GEN_PATTERN;
+    if ((long long)n > left)
+      n = left;
+    if (!forever && (long long)n > end - off)
+      n = end - off;
+    if (!forever && !chunked && off + (long long)n == end)
+      more = 0;
+    if (send_slice(fd, off, n, chunked, more) < 0)
+      return 0;
+    if (bps > 0 && (left -= n) == 0)
+    {
+      sleep_ms(GEN_TICK_MS);
+      left = tick;
+    }
+  }
+  if (end < size)
+    return 0; /* truncated: close without finishing the body */
+  if (chunked)
+  {
+    iov.iov_base = "0\r\n\r\n";
+    iov.iov_len = 5;
+    if (send_vec(fd, &iov, 1, 0) < 0)
+      return 0;
+  }
+  return keep;
+}
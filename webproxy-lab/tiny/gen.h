@@ -0,0 +1,40 @@
+/*
+ * gen.h - synthetic responses for proxy benchmarking (GET /gen?...)
+ *
+ * Bodies are slices of a fixed pattern buffer (byte i of a body is
+ * pattern[i % GEN_PATTERN]), so they cost no disk I/O and are the same
+ * on every run. Query parameters, all optional; a number that isn't a
+ * non-negative integer, or a cache value that decodes to control
+ * characters, gets a 400:
+ *
+ *   size=N         body length in bytes (default 1024)
+ *   delay_ms=N     wait before sending the header
+ *   chunked=1      Transfer-Encoding: chunked instead of Content-length
+ *   cache=VALUE    Cache-Control value, %XX-decoded (e.g. max-age=60)
+ *   trickle_bps=N  pace the body at about N bytes per second, sent as
+ *                  N * GEN_TICK_MS / 1000 bytes every GEN_TICK_MS (no cap)
+ *   truncate=N     close after N body bytes, short of the promised size
+ *   forever=1      chunked body that never ends
+ *   hang=1         read the request and never answer (like nop-server.py)
+ *
+ * HTTP/1.0 requests never get chunks: a chunked or endless body is sent
+ * without a length and ended by closing the connection.
+ */
+#ifndef __GEN_H__
+#define __GEN_H__
+
+#include "csapp.h"
+
+#define GEN_PATTERN (64 * 1024) /* pattern buffer size */
+#define GEN_SIZE 1024           /* default body size */
+#define GEN_TICK_MS 100         /* trickle pacing interval */
+
+int gen_path(const char *uri);
+int gen_serve(int fd, char *uri, char *eoh, int http11);
+
+/* tiny.c */
+void clienterror(int fd, char *cause, char *errnum, char *shortmsg,
+                 char *longmsg);
+ssize_t send_vec(int fd, struct iovec *iov, int iovcnt, int flags);
+
+#endif /* __GEN_H__ */
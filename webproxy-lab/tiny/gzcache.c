@@ -0,0 +1,152 @@
+/*
+ * gzcache.c - gzip-compressed bodies of tiny's text files
+ */
+#include "gzcache.h"
+#include <zlib.h>
+
+static gzent_t *buckets[GZCACHE_BUCKETS];
+static int nent;
+static unsigned long clock_;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static unsigned hash(const char *s)
+{
+  unsigned h = 5381;
+
+  while (*s)
+    h = h * 33 + (unsigned char)*s++;
+  return h % GZCACHE_BUCKETS;
+}
+
+static void release(gzent_t *g)
+{
+  if (--g->refcnt == 0)
+  {
+    free(g->path);
+    free(g->data);
+    free(g);
+  }
+}
+
+/* unlink g from its chain and drop the table's reference (lock held) */
+static void drop(gzent_t *g)
+{
+  gzent_t **pp = &buckets[hash(g->path)];
+
+  while (*pp != g)
+    pp = &(*pp)->next;
+  *pp = g->next;
+  nent--;
+  release(g);
+}
+
+/* evict the least recently used entry (lock held) */
+static void evict_lru(void)
+{
+  gzent_t *g, *victim = NULL;
+
+  for (int i = 0; i < GZCACHE_BUCKETS; i++)
+    for (g = buckets[i]; g; g = g->next)
+      if (!victim || g->used < victim->used)
+        victim = g;
+  if (victim)
+    drop(victim);
+}
+
+static int same_file(gzent_t *g, fent_t *fe)
+{
+  return g->ino == fe->ino && g->size == fe->size && g->mtime == fe->mtime;
+}
+
+/* gzip fe's body; data stays NULL if that would not make it smaller */
+static gzent_t *compress_file(fent_t *fe)
+{
+  gzent_t *g = Calloc(1, sizeof(*g));
+  char *in = Malloc(fe->size + 1);
+  z_stream zs = {0};
+
+  g->path = strdup(fe->path);
+  g->ino = fe->ino;
+  g->size = fe->size;
+  g->mtime = fe->mtime;
+  g->refcnt = 1;
+  if (pread(fe->fd, in, fe->size, 0) != fe->size ||
+      deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK)
+  {
+    free(in);
+    return g;
+  }
+  g->len = deflateBound(&zs, fe->size);
+  g->data = Malloc(g->len);
+  zs.next_in = (Bytef *)in;
+  zs.avail_in = fe->size;
+  zs.next_out = (Bytef *)g->data;
+  zs.avail_out = g->len;
+  if (deflate(&zs, Z_FINISH) != Z_STREAM_END || zs.total_out >= (uLong)fe->size)
+  {
+    free(g->data);
+    g->data = NULL;
+  }
+  g->len = zs.total_out;
+  deflateEnd(&zs);
+  free(in);
+  return g;
+}
+
+/*
+ * gzcache_get - return a referenced gzip body of fe's file, compressing
+ *     it on a miss. NULL if the file is too big or doesn't compress;
+ *     the caller then sends it as is. Release with gzcache_put().
+ */
+gzent_t *gzcache_get(fent_t *fe)
+{
+  unsigned h = hash(fe->path);
+  gzent_t *g, *fresh;
+
+  if (fe->size > GZ_MAX_FILE)
+    return NULL;
+  pthread_mutex_lock(&lock);
+  for (g = buckets[h]; g; g = g->next)
+    if (!strcmp(g->path, fe->path))
+      break;
+  if (g && !same_file(g, fe))
+  {
+    drop(g);
+    g = NULL;
+  }
+  if (!g)
+  { /* Compress without the lock, then insert unless someone beat us */
+    pthread_mutex_unlock(&lock);
+    fresh = compress_file(fe);
+    pthread_mutex_lock(&lock);
+    for (g = buckets[h]; g; g = g->next)
+      if (!strcmp(g->path, fe->path) && same_file(g, fe))
+        break;
+    if (g)
+      release(fresh);
+    else
+    {
+      if (nent >= GZCACHE_MAX)
+        evict_lru();
+      g = fresh;
+      g->next = buckets[h];
+      buckets[h] = g;
+      nent++;
+    }
+  }
+  g->used = ++clock_;
+  if (!g->data)
+    g = NULL;
+  else
+    g->refcnt++;
+  pthread_mutex_unlock(&lock);
+  return g;
+}
+
+void gzcache_put(gzent_t *g)
+{
+  pthread_mutex_lock(&lock);
+  release(g);
+  pthread_mutex_unlock(&lock);
+}
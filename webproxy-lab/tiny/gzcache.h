@@ -0,0 +1,37 @@
+/*
+ * gzcache.h - gzip-compressed bodies of tiny's text files
+ *
+ * A text file requested with Accept-Encoding: gzip and no up-to-date
+ * NAME.gz sibling is compressed once. The compressed bytes stay in memory,
+ * keyed by path and validated against the open-file cache entry's inode,
+ * size and mtime. Up to GZCACHE_MAX entries are kept, evicted LRU, and
+ * reference counted like fcache entries.
+ */
+#ifndef __GZCACHE_H__
+#define __GZCACHE_H__
+
+#include "csapp.h"
+#include "fcache.h"
+
+#define GZCACHE_MAX 64
+#define GZCACHE_BUCKETS 128
+#define GZ_MAX_FILE (16 << 20) /* larger files are sent uncompressed */
+
+typedef struct gzent
+{
+  char *path;
+  ino_t ino;           /* fent_t identity this was compressed from */
+  off_t size;
+  time_t mtime;
+  char *data;          /* gzip stream, NULL if compressing didn't pay */
+  size_t len;
+
+  unsigned long used;  /* LRU stamp */
+  int refcnt;          /* 1 for the table + 1 per request in flight */
+  struct gzent *next;  /* hash chain */
+} gzent_t;
+
+gzent_t *gzcache_get(fent_t *fe);
+void gzcache_put(gzent_t *g);
+
+#endif /* __GZCACHE_H__ */
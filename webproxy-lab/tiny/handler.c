@@ -0,0 +1,90 @@
+/*
+ * handler.c - in-process dynamic handlers loaded with dlopen()
+ */
+#include "handler.h"
+#include <dirent.h>
+#include <dlfcn.h>
+
+typedef struct hentry
+{
+  char *path; /* "./cgi-bin/NAME", as built by parse_uri() */
+  handler_fn fn;
+  struct hentry *next;
+} hentry_t;
+
+static hentry_t *handlers; /* filled once at startup, read-only after */
+static __thread char *out;  /* this thread's response buffer */
+
+/*
+ * handler_load - dlopen every *.so in dir that exports HANDLER_SYM.
+ *     Returns the number of handlers loaded.
+ */
+int handler_load(const char *dir)
+{
+  char path[MAXLINE];
+  struct dirent *de;
+  hentry_t *h;
+  void *dl, *fn;
+  size_t len;
+  DIR *dp;
+  int n = 0;
+
+  if ((dp = opendir(dir)) == NULL)
+    return 0;
+  while ((de = readdir(dp)) != NULL)
+  {
+    len = strlen(de->d_name);
+    if (len < 4 || strcmp(de->d_name + len - 3, ".so") ||
+        snprintf(path, sizeof(path), "%s/%s", dir, de->d_name) >= (int)sizeof(path))
+      continue;
+    if ((dl = dlopen(path, RTLD_NOW | RTLD_LOCAL)) == NULL)
+    {
+      fprintf(stderr, "handler: %s\n", dlerror());
+      continue;
+    }
+    if ((fn = dlsym(dl, HANDLER_SYM)) == NULL)
+    {
+      fprintf(stderr, "handler: %s has no %s()\n", path, HANDLER_SYM);
+      dlclose(dl);
+      continue;
+    }
+    h = Calloc(1, sizeof(*h));
+    h->path = strndup(path, strlen(path) - 3);
+    *(void **)&h->fn = fn;
+    h->next = handlers;
+    handlers = h;
+    printf("handler: %s -> %s()\n", h->path, HANDLER_SYM);
+    n++;
+  }
+  closedir(dp);
+  fflush(stdout);
+  return n;
+}
+
+/*
+ * handler_serve - answer filename?cgiargs with its loaded handler.
+ *     Returns -1, having sent nothing, if filename has none.
+ */
+int handler_serve(int fd, char *filename, char *cgiargs)
+{
+  hentry_t *h;
+  int n;
+
+  for (h = handlers; h; h = h->next)
+    if (!strcmp(h->path, filename))
+      break;
+  if (!h)
+    return -1;
+
+  if (!out)
+    out = Malloc(HANDLER_BUFSIZE);
+  if ((n = h->fn(cgiargs, out, HANDLER_BUFSIZE)) < 0 || n > HANDLER_BUFSIZE)
+  {
+    clienterror(fd, filename, "500", "Internal server error",
+                "Tiny’s handler failed");
+    return 0;
+  }
+  if (send_cgi(fd, out, n) < 0)
+    fprintf(stderr, "handler_serve: write error: %s\n", strerror(errno));
+  return 0;
+}
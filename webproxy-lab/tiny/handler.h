@@ -0,0 +1,31 @@
+/*
+ * handler.h - in-process dynamic handlers loaded with dlopen()
+ *
+ * At startup tiny dlopen()s every cgi-bin/NAME.so that exports
+ *
+ *     int handle(const char *query, char *out, size_t n);
+ *
+ * and serves /cgi-bin/NAME by calling it on the connection's own thread.
+ * handle() writes CGI output (header lines, blank line, body) into the
+ * caller's per-thread buffer of n bytes and returns its length, or -1.
+ * Requests without a handler go to the worker pool or fork as before.
+ */
+#ifndef __HANDLER_H__
+#define __HANDLER_H__
+
+#include "csapp.h"
+
+#define HANDLER_SYM "handle"
+#define HANDLER_BUFSIZE (64 * 1024) /* per-thread response buffer */
+
+typedef int (*handler_fn)(const char *query, char *out, size_t n);
+
+int handler_load(const char *dir);
+int handler_serve(int fd, char *filename, char *cgiargs);
+
+/* tiny.c */
+void clienterror(int fd, char *cause, char *errnum, char *shortmsg,
+                 char *longmsg);
+ssize_t send_cgi(int fd, char *out, size_t n);
+
+#endif /* __HANDLER_H__ */
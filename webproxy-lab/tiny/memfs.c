@@ -0,0 +1,177 @@
+/*
+ * memfs.c - fully in-memory static content (tiny -m)
+ */
+#include "memfs.h"
+#include "fcache.h" /* get_filetype(), make_etag(), static_header() */
+#include <dirent.h>
+
+static mfile_t **table; /* current table, NULL until memfs_load() */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static unsigned hash(const char *s)
+{
+  unsigned h = 5381;
+
+  while (*s)
+    h = h * 33 + (unsigned char)*s++;
+  return h % MEMFS_BUCKETS;
+}
+
+static void release(mfile_t *m)
+{
+  if (__atomic_sub_fetch(&m->refcnt, 1, __ATOMIC_ACQ_REL) == 0)
+  {
+    free(m->path);
+    free(m->data);
+    free(m);
+  }
+}
+
+/* read path into one buffer holding its full response; NULL on error */
+static mfile_t *load_file(const char *path)
+{
+  struct stat sbuf;
+  char hdr[MAXLINE], filetype[64];
+  size_t hlen;
+  mfile_t *m;
+  int fd;
+
+  if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0)
+    return NULL;
+  if (fstat(fd, &sbuf) < 0 || !S_ISREG(sbuf.st_mode))
+  {
+    close(fd);
+    return NULL;
+  }
+  m = Calloc(1, sizeof(*m));
+  get_filetype((char *)path, filetype);
+  make_etag(m->etag, sbuf.st_ino, sbuf.st_size, sbuf.st_mtime, 0);
+  m->mtime = sbuf.st_mtime;
+  hlen = static_header(hdr, sizeof(hdr), sbuf.st_size, filetype,
+                       m->etag, m->mtime);
+
+  m->path = strdup(path);
+  m->len = hlen + sbuf.st_size;
+  m->hdr_len = hlen;
+  m->data = Malloc(m->len);
+  m->refcnt = 1;
+  memcpy(m->data, hdr, hlen);
+  if (rio_readn(fd, m->data + hlen, sbuf.st_size) != sbuf.st_size)
+  {
+    close(fd);
+    release(m);
+    return NULL;
+  }
+  close(fd);
+  return m;
+}
+
+/* 1 if name ends in one of MEMFS_EXTS */
+static int servable(const char *name)
+{
+  static const char *exts[] = MEMFS_EXTS;
+  size_t len = strlen(name), n;
+
+  for (int i = 0; exts[i]; i++)
+    if (len > (n = strlen(exts[i])) && !strcmp(name + len - n, exts[i]))
+      return 1;
+  return 0;
+}
+
+/*
+ * load_dir - add every servable file under dir to t. Skips dot files,
+ *     cgi-bin/ and symlinks (lstat), so a link loop can't recurse.
+ */
+static void load_dir(mfile_t **t, const char *dir, int *nfiles, size_t *bytes)
+{
+  char path[MAXLINE];
+  struct dirent *de;
+  struct stat sbuf;
+  DIR *dp;
+
+  if ((dp = opendir(dir)) == NULL)
+    return;
+  while ((de = readdir(dp)) != NULL)
+  {
+    if (de->d_name[0] == '.' || !strcmp(de->d_name, "cgi-bin"))
+      continue;
+    if (snprintf(path, sizeof(path), "%s/%s", dir, de->d_name) >= (int)sizeof(path) ||
+        lstat(path, &sbuf) < 0)
+      continue;
+    if (S_ISDIR(sbuf.st_mode))
+      load_dir(t, path, nfiles, bytes);
+    else if (S_ISREG(sbuf.st_mode) && (S_IRUSR & sbuf.st_mode) &&
+             sbuf.st_size <= MEMFS_MAX_FILE && servable(de->d_name))
+    {
+      mfile_t *m = load_file(path);
+      unsigned h;
+
+      if (!m)
+        continue;
+      h = hash(m->path);
+      m->next = t[h];
+      t[h] = m;
+      (*nfiles)++;
+      *bytes += m->len;
+    }
+  }
+  closedir(dp);
+}
+
+/*
+ * memfs_load - (re)build the in-memory table from the tree under root
+ *     and report its resident size. Returns the number of files loaded.
+ */
+int memfs_load(const char *root)
+{
+  mfile_t **t = Calloc(MEMFS_BUCKETS, sizeof(*t)), **old;
+  size_t bytes = 0;
+  int nfiles = 0;
+
+  load_dir(t, root, &nfiles, &bytes);
+
+  pthread_mutex_lock(&lock);
+  old = table;
+  table = t;
+  pthread_mutex_unlock(&lock);
+
+  if (old)
+  {
+    for (int i = 0; i < MEMFS_BUCKETS; i++)
+      for (mfile_t *m = old[i], *next; m; m = next)
+      {
+        next = m->next;
+        release(m);
+      }
+    free(old);
+  }
+  printf("memfs: %d files, %zu bytes resident (%.1f MiB)\n",
+         nfiles, bytes, bytes / (1024.0 * 1024.0));
+  fflush(stdout);
+  return nfiles;
+}
+
+int memfs_enabled(void)
+{
+  return table != NULL;
+}
+
+/* referenced response for path, or NULL; release with memfs_put() */
+mfile_t *memfs_get(const char *path)
+{
+  mfile_t *m;
+
+  pthread_mutex_lock(&lock);
+  for (m = table[hash(path)]; m; m = m->next)
+    if (!strcmp(m->path, path))
+      break;
+  if (m)
+    __atomic_add_fetch(&m->refcnt, 1, __ATOMIC_RELAXED);
+  pthread_mutex_unlock(&lock);
+  return m;
+}
+
+void memfs_put(mfile_t *m)
+{
+  release(m);
+}
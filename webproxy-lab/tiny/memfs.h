@@ -0,0 +1,44 @@
+/*
+ * memfs.h - fully in-memory static content (tiny -m)
+ *
+ * At startup the directory tree under the document root is read into
+ * memory. Each servable file (a MEMFS_EXTS suffix, at most
+ * MEMFS_MAX_FILE bytes) becomes one contiguous buffer holding the
+ * complete HTTP response except the Connection line, so serving it is a
+ * hash lookup and a single sendmsg() that splices that line in. Dot
+ * files, cgi-bin/ and symlinks are skipped; anything not loaded is still
+ * served from disk through fcache.
+ *
+ * memfs_load() can be called again (tiny does so on SIGHUP) to rebuild
+ * the table from disk. The new table replaces the old one atomically.
+ * Responses still being sent keep their buffer alive through a reference
+ * count.
+ */
+#ifndef __MEMFS_H__
+#define __MEMFS_H__
+
+#include "csapp.h"
+#include "fcache.h" /* ETAG_LEN */
+
+#define MEMFS_BUCKETS 1024
+#define MEMFS_MAX_FILE (64 << 20)
+#define MEMFS_EXTS {".html", ".gif", ".png", ".jpg", ".txt", ".c", ".h", NULL}
+
+typedef struct mfile
+{
+  char *path;   /* "./dir/file", as built by parse_uri() */
+  char *data;    /* static_header() + body */
+  size_t len;
+  size_t hdr_len; /* body starts at data + hdr_len */
+  char etag[ETAG_LEN];
+  time_t mtime;
+  int refcnt;   /* 1 for the table + 1 per request in flight */
+  struct mfile *next;
+} mfile_t;
+
+int memfs_load(const char *root);
+int memfs_enabled(void);
+mfile_t *memfs_get(const char *path);
+void memfs_put(mfile_t *m);
+
+#endif /* __MEMFS_H__ */
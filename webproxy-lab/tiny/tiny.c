@@ -1,76 +1,192 @@
 /* $begin tinymain */
 /*
- * tiny.c - A simple, iterative HTTP/1.0 Web server that uses the
+ * tiny.c - A simple, iterative HTTP/1.1 Web server that uses the
  *     GET method to serve static and dynamic content.
+ *     With -t N it becomes a prethreaded server: the main thread accepts
+ *     and N worker threads serve connections taken from an sbuf. Only then
+ *     do static responses keep the connection open for HTTP/1.1 clients
+ *     (and HTTP/1.0 ones asking for keep-alive); pipelined requests are
+ *     read back to back from the connection's rio buffer and answered in
+ *     order. The iterative server closes after every response, so an idle
+ *     client can't hold up the others.
+ *     With -c N, CGI programs that support it run as N persistent
+ *     workers each instead of one fork/exec per request (cgipool.c).
+ *     cgi-bin/NAME.so handlers found at startup run in-process (handler.c).
+ *     GET /gen?... produces synthetic responses for benchmarks (gen.c).
+ *     Text files go out gzipped to clients that accept it, from a NAME.gz
+ *     sibling or compressed once and kept in memory (gzcache.c).
+ *     Static responses carry ETag and Last-Modified; If-None-Match and
+ *     If-Modified-Since are answered with 304 Not Modified.
  *
  * Updated 11/2019 droh
  *   - Fixed sprintf() aliasing issue in serve_static(), and clienterror().
  */
 #include "csapp.h"
+#include "fcache.h"
+#include "memfs.h"
+#include "cgipool.h"
+#include "handler.h"
+#include "gen.h"
+#include "gzcache.h"
+#include "sbuf.h"
+#include <sys/sendfile.h>
+#include <sys/uio.h>
+
+/* What serve_request needs from the request headers */
+typedef struct
+{
+  int keep;           /* leave the connection open after the response */
+  int gzip;           /* Accept-Encoding allows gzip */
+  char inm[MAXLINE];  /* If-None-Match value, "" if absent */
+  time_t ims;         /* If-Modified-Since, -1 if absent or malformed */
+} reqhdrs_t;
 
 void doit(int fd);
-void read_requesthdrs(rio_t *rp);
+int serve_request(int fd, rio_t *rp);
+int read_requesthdrs(rio_t *rp, reqhdrs_t *rh);
+int accepts_gzip(char *value);
 int parse_uri(char *uri, char *filename, char *cgiargs);
-void serve_static(int fd, char *filename, int filesize);
+int serve_file(int fd, char *filename, reqhdrs_t *rh, int gzip, char *eoh);
+int not_modified(reqhdrs_t *rh, char *etag, time_t mtime);
+void serve_304(int fd, char *etag, time_t mtime, char *filetype, char *eoh);
+void http_date(char *buf, size_t n, time_t t);
+time_t parse_http_date(char *s);
+int serve_static(int fd, fent_t *fe, char *extra, char *eoh);
+void serve_gzip(int fd, fent_t *fe, gzent_t *g, char *eoh);
+ssize_t send_vec(int fd, struct iovec *iov, int iovcnt, int flags);
+ssize_t sendfile_all(int fd, int srcfd, size_t n);
 void get_filetype(char *filename, char *filetype);
 void serve_dynamic(int fd, char *filename, char *cgiargs);
+ssize_t send_cgi(int fd, char *out, size_t n);
 void clienterror(int fd, char *cause, char *errnum, char *shortmsg,
                  char *longmsg);
+void *reload_thread(void *vargp);
+void *worker(void *vargp);
+
+#define SBUFSIZE 256     /* accepted connections waiting for a worker */
+#define NTHREADS_MAX 1024
+#define KEEPALIVE_SECS 5 /* idle time before a persistent connection is closed */
+#define GZIP_HDR "Content-Encoding: gzip\r\n"
 
+static sbuf_t sbuf;   /* connected descriptors, -t mode only */
+static int keepalive; /* persistent connections allowed (-t mode only) */
+
+/*
+ * doit - serve the requests of one connection until the client closes it,
+ *     a response ends with Connection: close, or it idles KEEPALIVE_SECS
+ */
 void doit(int fd)
 {
-  int is_static;
+  struct timeval tv = {KEEPALIVE_SECS, 0};
+  rio_t rio;
+
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  Rio_readinitb(&rio, fd);
+  while (serve_request(fd, &rio))
+    ;
+}
+
+/*
+ * serve_request - read and answer one request from rp.
+ *     Returns 1 if the connection stays open for the next one.
+ */
+int serve_request(int fd, rio_t *rp)
+{
+  int is_static, keep, gzip = 0;
   struct stat sbuf;
+  reqhdrs_t rh;
+  mfile_t *m;
   char buf[MAXLINE], method[MAXLINE], uri[MAXLINE], version[MAXLINE];
-  char filename[MAXLINE], cgiargs[MAXLINE];
-  rio_t rio;
+  char filename[MAXLINE], cgiargs[MAXLINE], *eoh;
   /* Read request line and headers */
-  Rio_readinitb(&rio, fd);
-  Rio_readlineb(&rio, buf, MAXLINE);
+  if (rio_readlineb(rp, buf, MAXLINE) <= 0) /* Closed, idle or error */
+    return 0;
   printf("Request headers:\n");
   printf("%s", buf);
-  sscanf(buf, "%s %s %s", method, uri, version);
+  if (sscanf(buf, "%s %s %s", method, uri, version) != 3)
+  {
+    clienterror(fd, buf, "400", "Bad request",
+                "Tiny couldn’t parse the request line");
+    return 0;
+  }
   if (strcasecmp(method, "GET"))
   {
     clienterror(fd, method, "501", "Not implemented",
                 "Tiny does not implement this method");
-    return;
+    return 0;
   }
-  read_requesthdrs(&rio);
+  rh.keep = !strcasecmp(version, "HTTP/1.1");
+  rh.gzip = 0;
+  rh.inm[0] = '\0';
+  rh.ims = -1;
+  if (read_requesthdrs(rp, &rh) < 0)
+    return 0;
+  keep = rh.keep && keepalive;
+  /* End of the static response header: the Connection line, if any */
+  if (!keep)
+    eoh = "Connection: close\r\n\r\n";
+  else if (strcasecmp(version, "HTTP/1.1"))
+    eoh = "Connection: keep-alive\r\n\r\n";
+  else
+    eoh = "\r\n";
+  if (gen_path(uri))
+    return gen_serve(fd, uri, eoh, !strcasecmp(version, "HTTP/1.1"));
   /* Parse URI from GET request */
   is_static = parse_uri(uri, filename, cgiargs);
+  if (is_static)
+  { /* Only text is worth gzipping */
+    char filetype[64];
+    get_filetype(filename, filetype);
+    gzip = rh.gzip && !strncmp(filetype, "text/", 5);
+  }
+  if (is_static && !gzip && memfs_enabled() && (m = memfs_get(filename)) != NULL)
+  { /* In-memory mode: the whole prebuilt response in one send, held back
+       (MSG_MORE) while the client has more pipelined requests buffered */
+    struct iovec iov[3] = {{m->data, m->hdr_len},
+                           {eoh, strlen(eoh)},
+                           {m->data + m->hdr_len, m->len - m->hdr_len}};
+    if (not_modified(&rh, m->etag, m->mtime))
+    {
+      char filetype[64];
+      get_filetype(filename, filetype);
+      serve_304(fd, m->etag, m->mtime, filetype, eoh);
+    }
+    else if (send_vec(fd, iov, 3, rp->rio_cnt > 0 ? MSG_MORE : 0) < 0)
+      keep = 0;
+    memfs_put(m);
+    return keep;
+  }
+  if (is_static)
+  { /* Serve static content from the open-file cache */
+    int status = serve_file(fd, filename, &rh, gzip, eoh);
+    return status < 0 || status >= 400 ? 0 : keep;
+  }
+  /* Serve dynamic content: in-process handler, worker pool, or fork */
+  if (handler_serve(fd, filename, cgiargs) == 0)
+    return 0;
   if (stat(filename, &sbuf) < 0)
   {
     clienterror(fd, filename, "404", "Not found",
                 "Tiny couldn’t find this file");
-    return;
+    return 0;
   }
-  if (is_static)
-  { /* Serve static content */
-    if (!(S_ISREG(sbuf.st_mode)) || !(S_IRUSR & sbuf.st_mode))
-    {
-      clienterror(fd, filename, "403", "Forbidden",
-                  "Tiny couldn’t read the file");
-      return;
-    }
-    serve_static(fd, filename, sbuf.st_size);
+  if (!(S_ISREG(sbuf.st_mode)) || !(S_IXUSR & sbuf.st_mode))
+  {
+    clienterror(fd, filename, "403", "Forbidden",
+                "Tiny couldn’t run the CGI program");
+    return 0;
   }
-  else
-  { /* Serve dynamic content */
-    if (!(S_ISREG(sbuf.st_mode)) || !(S_IXUSR & sbuf.st_mode))
-    {
-      clienterror(fd, filename, "403", "Forbidden",
-                  "Tiny couldn’t run the CGI program");
-      return;
-    }
+  /* The CGI program writes the rest of the response; close after it */
+  if (cgipool_serve(fd, filename, cgiargs) < 0)
     serve_dynamic(fd, filename, cgiargs);
-  }
+  return 0;
 }
 
 void clienterror(int fd, char *cause, char *errnum,
                  char *shortmsg, char *longmsg)
 {
   char buf[MAXLINE], body[MAXBUF];
+  struct iovec iov[2];
   /* Build the HTTP response body */
   sprintf(body, "<html><title>Tiny Error</title>");
   sprintf(body, "%s<body bgcolor="
@@ -80,27 +196,70 @@ void clienterror(int fd, char *cause, char *errnum,
   sprintf(body, "%s%s: %s\r\n", body, errnum, shortmsg);
   sprintf(body, "%s<p>%s: %s\r\n", body, longmsg, cause);
   sprintf(body, "%s<hr><em>The Tiny Web server</em>\r\n", body);
-  /* Print the HTTP response */
+  /* Print the HTTP response; a client that went away only ends its own
+     connection (callers close after an error) */
   sprintf(buf, "HTTP/1.0 %s %s\r\n", errnum, shortmsg);
-  Rio_writen(fd, buf, strlen(buf));
-  sprintf(buf, "Content-type: text/html\r\n");
-  Rio_writen(fd, buf, strlen(buf));
-  sprintf(buf, "Content-length: %d\r\n\r\n", (int)strlen(body));
-  Rio_writen(fd, buf, strlen(buf));
-  Rio_writen(fd, body, strlen(body));
+  sprintf(buf + strlen(buf), "Connection: close\r\n");
+  sprintf(buf + strlen(buf), "Content-type: text/html\r\n");
+  sprintf(buf + strlen(buf), "Content-length: %d\r\n\r\n", (int)strlen(body));
+  iov[0].iov_base = buf;
+  iov[0].iov_len = strlen(buf);
+  iov[1].iov_base = body;
+  iov[1].iov_len = strlen(body);
+  if (send_vec(fd, iov, 2, 0) < 0)
+    fprintf(stderr, "clienterror: write error: %s\n", strerror(errno));
 }
 
-void read_requesthdrs(rio_t *rp)
+/*
+ * read_requesthdrs - read the request headers, keeping the ones tiny acts
+ *     on (Connection, Accept-Encoding, If-None-Match, If-Modified-Since)
+ *     in *rh. Returns -1 if the client went away first.
+ */
+int read_requesthdrs(rio_t *rp, reqhdrs_t *rh)
 {
   char buf[MAXLINE];
 
-  Rio_readlineb(rp, buf, MAXLINE);
-  while (strcmp(buf, "\r\n"))
+  do
   {
-    Rio_readlineb(rp, buf, MAXLINE);
+    if (rio_readlineb(rp, buf, MAXLINE) <= 0)
+      return -1;
     printf("%s", buf);
-  }
-  return;
+    if (!strncasecmp(buf, "Connection:", 11))
+    {
+      for (char *p = buf + 11; *p; p++)
+        *p = tolower((unsigned char)*p);
+      if (strstr(buf + 11, "close"))
+        rh->keep = 0;
+      else if (strstr(buf + 11, "keep-alive"))
+        rh->keep = 1;
+    }
+    else if (!strncasecmp(buf, "Accept-Encoding:", 16))
+      rh->gzip = accepts_gzip(buf + 16);
+    else if (!strncasecmp(buf, "If-None-Match:", 14))
+    {
+      char *v = buf + 14 + strspn(buf + 14, " \t");
+      snprintf(rh->inm, sizeof(rh->inm), "%.*s", (int)strcspn(v, "\r\n"), v);
+    }
+    else if (!strncasecmp(buf, "If-Modified-Since:", 18))
+      rh->ims = parse_http_date(buf + 18);
+  } while (strcmp(buf, "\r\n"));
+  return 0;
+}
+
+/* accepts_gzip - 1 if an Accept-Encoding value lists gzip without q=0 */
+int accepts_gzip(char *value)
+{
+  char *p;
+
+  for (p = value; *p; p++)
+    *p = tolower((unsigned char)*p);
+  if ((p = strstr(value, "gzip")) == NULL)
+    return 0;
+  p += strspn(p + 4, " \t") + 4;
+  if (*p != ';')
+    return 1;
+  p += strspn(p + 1, " \t") + 1;
+  return strncmp(p, "q=", 2) || strtod(p + 2, NULL) > 0;
 }
 
 int parse_uri(char *uri, char *filename, char *cgiargs)
@@ -131,26 +290,288 @@ int parse_uri(char *uri, char *filename, char *cgiargs)
   }
 }
 
-void serve_static(int fd, char *filename, int filesize)
+/*
+ * serve_file - answer a static request for filename. With gzip set, an
+ *     up-to-date filename.gz is sent instead, or else the compressed copy
+ *     from gzcache. A representation the client already has (per rh)
+ *     gets a 304. Returns the status code sent, or -1 if the body came
+ *     up short and the connection has to close.
+ */
+int serve_file(int fd, char *filename, reqhdrs_t *rh, int gzip, char *eoh)
 {
-  int srcfd;
-  char *srcp, filetype[MAXLINE], buf[MAXBUF];
-  /* Send response headers to client */
-  get_filetype(filename, filetype);
-  sprintf(buf, "HTTP/1.0 200 OK\r\n");
-  sprintf(buf, "%sServer: Tiny Web Server\r\n", buf);
-  sprintf(buf, "%sConnection: close\r\n", buf);
-  sprintf(buf, "%sContent-length: %d\r\n", buf, filesize);
-  sprintf(buf, "%sContent-type: %s\r\n\r\n", buf, filetype);
-  Rio_writen(fd, buf, strlen(buf));
+  char gzname[MAXLINE + 3], etag[ETAG_LEN];
+  fent_t *fe, *gfe;
+  gzent_t *g;
+  int status;
+
+  if ((fe = fcache_get(filename, &status)) == NULL)
+  {
+    if (status == 404)
+      clienterror(fd, filename, "404", "Not found",
+                  "Tiny couldn’t find this file");
+    else
+      clienterror(fd, filename, "403", "Forbidden",
+                  "Tiny couldn’t read the file");
+    return status;
+  }
+  if (gzip)
+  {
+    sprintf(gzname, "%s.gz", filename);
+    if ((gfe = fcache_get(gzname, &status)) != NULL)
+    {
+      if (gfe->mtime >= fe->mtime)
+      { /* Precompressed sibling; its header already has fe's type */
+        if ((status = not_modified(rh, gfe->etag, gfe->mtime) ? 304 : 200) == 304)
+          serve_304(fd, gfe->etag, gfe->mtime, gfe->filetype, eoh);
+        else if (serve_static(fd, gfe, GZIP_HDR, eoh) < 0)
+          status = -1;
+        fcache_put(gfe);
+        fcache_put(fe);
+        return status;
+      }
+      fcache_put(gfe);
+    }
+    /* Only compress if the client lacks the gzip copy */
+    make_etag(etag, fe->ino, fe->size, fe->mtime, 1);
+    if (not_modified(rh, etag, fe->mtime))
+    {
+      serve_304(fd, etag, fe->mtime, fe->filetype, eoh);
+      fcache_put(fe);
+      return 304;
+    }
+    if ((g = gzcache_get(fe)) != NULL)
+    {
+      serve_gzip(fd, fe, g, eoh);
+      gzcache_put(g);
+      fcache_put(fe);
+      return 200;
+    }
+  }
+  if ((status = not_modified(rh, fe->etag, fe->mtime) ? 304 : 200) == 304)
+    serve_304(fd, fe->etag, fe->mtime, fe->filetype, eoh);
+  else if (serve_static(fd, fe, "", eoh) < 0)
+    status = -1;
+  fcache_put(fe);
+  return status;
+}
+
+/*
+ * not_modified - 1 if the request's validators match: If-None-Match
+ *     lists etag (weakly, or "*"), or, without If-None-Match,
+ *     If-Modified-Since is no older than mtime
+ */
+int not_modified(reqhdrs_t *rh, char *etag, time_t mtime)
+{
+  size_t len = strlen(etag);
+  char *p = rh->inm;
+
+  if (!*p)
+    return rh->ims != -1 && mtime <= rh->ims;
+  while (*p)
+  {
+    p += strspn(p, " \t,");
+    if (*p == '*')
+      return 1;
+    if (!strncmp(p, "W/", 2))
+      p += 2;
+    if (!strncmp(p, etag, len) && (p[len] == '\0' || strchr(" \t,", p[len])))
+      return 1;
+    p += strcspn(p, ",");
+  }
+  return 0;
+}
+
+/* serve_304 - header-only answer with the representation's validators */
+void serve_304(int fd, char *etag, time_t mtime, char *filetype, char *eoh)
+{
+  char hdr[MAXLINE], date[64];
+  struct iovec iov[2] = {{hdr, 0}, {eoh, strlen(eoh)}};
+
+  http_date(date, sizeof(date), mtime);
+  iov[0].iov_len = snprintf(hdr, sizeof(hdr),
+                            "HTTP/1.1 304 Not Modified\r\n"
+                            "Server: Tiny Web Server\r\n"
+                            "ETag: %s\r\n"
+                            "Last-Modified: %s\r\n%s",
+                            etag, date,
+                            strncmp(filetype, "text/", 5) ? "" : "Vary: Accept-Encoding\r\n");
+  if (iov[0].iov_len >= sizeof(hdr))
+    return;
   printf("Response headers:\n");
-  printf("%s", buf);
-  /* Send response body to client */
-  srcfd = Open(filename, O_RDONLY, 0);
-  srcp = Mmap(0, filesize, PROT_READ, MAP_PRIVATE, srcfd, 0);
-  Close(srcfd);
-  Rio_writen(fd, srcp, filesize);
-  Munmap(srcp, filesize);
+  printf("%s%s", hdr, eoh);
+  if (send_vec(fd, iov, 2, 0) < 0)
+    fprintf(stderr, "serve_304: write error: %s\n", strerror(errno));
+}
+
+/*
+ * serve_static - send the prebuilt header of a cached file, the extra
+ *     header lines and eoh, then its body from the cached fd (no
+ *     stat/open/close per request). Returns -1 if the header or the whole
+ *     body couldn't be sent, e.g. the file shrank since it was cached.
+ */
+int serve_static(int fd, fent_t *fe, char *extra, char *eoh)
+{
+  struct iovec iov[3] = {{fe->hdr, fe->hdr_len},
+                         {extra, strlen(extra)},
+                         {eoh, strlen(eoh)}};
+  ssize_t sent;
+
+  /* Send response headers to client, held back (MSG_MORE) until the body
+     follows; an empty file has none, so don't leave them corked */
+  if (send_vec(fd, iov, 3, fe->size > 0 ? MSG_MORE : 0) < 0)
+    return -1;
+  printf("Response headers:\n");
+  printf("%s%s%s", fe->hdr, extra, eoh);
+  /* Send response body to client straight from the page cache */
+  if ((sent = sendfile_all(fd, fe->fd, fe->size)) < fe->size)
+  {
+    if (sent < 0)
+      fprintf(stderr, "serve_static: sendfile error: %s\n", strerror(errno));
+    else
+      fprintf(stderr, "serve_static: %s is shorter than its %lld bytes\n",
+              fe->path, (long long)fe->size);
+    return -1;
+  }
+  return 0;
+}
+
+/* serve_gzip - send fe's file as the gzip body held by g */
+void serve_gzip(int fd, fent_t *fe, gzent_t *g, char *eoh)
+{
+  char hdr[MAXLINE], etag[ETAG_LEN];
+  size_t len;
+
+  make_etag(etag, fe->ino, fe->size, fe->mtime, 1);
+  len = static_header(hdr, sizeof(hdr), g->len, fe->filetype, etag, fe->mtime);
+  struct iovec iov[4] = {{hdr, len},
+                         {GZIP_HDR, strlen(GZIP_HDR)},
+                         {eoh, strlen(eoh)},
+                         {g->data, g->len}};
+
+  if (send_vec(fd, iov, 4, 0) < 0)
+    fprintf(stderr, "serve_gzip: write error: %s\n", strerror(errno));
+}
+
+/*
+ * send_vec - write all of iov[] with sendmsg, resuming after partial
+ *     sends. With flags = MSG_MORE the kernel coalesces the data with
+ *     what is sent next. Returns the byte count, or -1 on error.
+ */
+ssize_t send_vec(int fd, struct iovec *iov, int iovcnt, int flags)
+{
+  struct msghdr msg = {0};
+  size_t total = 0;
+  ssize_t rc;
+
+  msg.msg_iov = iov;
+  msg.msg_iovlen = iovcnt;
+  while (msg.msg_iovlen > 0)
+  {
+    if ((rc = sendmsg(fd, &msg, flags)) < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      return -1;
+    }
+    total += rc;
+    while (msg.msg_iovlen > 0 && (size_t)rc >= msg.msg_iov->iov_len)
+    {
+      rc -= msg.msg_iov->iov_len;
+      msg.msg_iov++;
+      msg.msg_iovlen--;
+    }
+    if (msg.msg_iovlen > 0)
+    {
+      msg.msg_iov->iov_base = (char *)msg.msg_iov->iov_base + rc;
+      msg.msg_iov->iov_len -= rc;
+    }
+  }
+  return total;
+}
+
+/*
+ * sendfile_all - send n bytes of srcfd to fd, resuming after partial
+ *     sends. Returns the number of bytes sent (less than n if the file
+ *     shrank), or -1 on error.
+ */
+ssize_t sendfile_all(int fd, int srcfd, size_t n)
+{
+  off_t off = 0;
+  ssize_t rc;
+
+  while ((size_t)off < n)
+  {
+    if ((rc = sendfile(fd, srcfd, &off, n - off)) < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      return -1;
+    }
+    if (rc == 0)
+      break;
+  }
+  return off;
+}
+
+/*
+ * make_etag - strong validator for one representation of a file:
+ *     "ino-size-mtime" in hex, with a -gz suffix for its gzip copy
+ */
+void make_etag(char *etag, ino_t ino, off_t size, time_t mtime, int gzip)
+{
+  snprintf(etag, ETAG_LEN, "\"%llx-%llx-%llx%s\"", (unsigned long long)ino,
+           (unsigned long long)size, (unsigned long long)mtime, gzip ? "-gz" : "");
+}
+
+/* http_date - format t as an IMF-fixdate ("Sun, 06 Nov 1994 08:49:37 GMT") */
+void http_date(char *buf, size_t n, time_t t)
+{
+  struct tm tm;
+
+  strftime(buf, n, "%a, %d %b %Y %H:%M:%S GMT", gmtime_r(&t, &tm));
+}
+
+/* parse_http_date - inverse of http_date(); -1 if s isn't an IMF-fixdate */
+time_t parse_http_date(char *s)
+{
+  static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+  struct tm tm = {0};
+  char mon[4], *p;
+
+  if (sscanf(s, " %*3s, %d %3s %d %d:%d:%d GMT", &tm.tm_mday, mon, &tm.tm_year,
+             &tm.tm_hour, &tm.tm_min, &tm.tm_sec) != 6 ||
+      (p = strstr(months, mon)) == NULL || (p - months) % 3)
+    return -1;
+  tm.tm_mon = (p - months) / 3;
+  tm.tm_year -= 1900;
+  return timegm(&tm);
+}
+
+/*
+ * static_header - build the response header for a static file of the
+ *     given size, type and validators into buf, up to but not including
+ *     the Connection line and blank line, which depend on the request.
+ *     Text types may also be sent gzipped, so they carry Vary.
+ *     Returns its length.
+ */
+size_t static_header(char *buf, size_t n, off_t size, char *filetype,
+                     char *etag, time_t mtime)
+{
+  char date[64];
+  int len;
+
+  http_date(date, sizeof(date), mtime);
+  len = snprintf(buf, n,
+                 "HTTP/1.1 200 OK\r\n"
+                 "Server: Tiny Web Server\r\n"
+                 "Content-length: %lld\r\n"
+                 "Content-type: %s\r\n"
+                 "ETag: %s\r\n"
+                 "Last-Modified: %s\r\n%s",
+                 (long long)size, filetype, etag, date,
+                 strncmp(filetype, "text/", 5) ? "" : "Vary: Accept-Encoding\r\n");
+
+  return len < 0 ? 0 : (size_t)len < n ? (size_t)len : n - 1;
 }
 
 void get_filetype(char *filename, char *filetype)
@@ -170,36 +591,119 @@ void get_filetype(char *filename, char *filetype)
 void serve_dynamic(int fd, char *filename, char *cgiargs)
 {
   char buf[MAXLINE], *emptylist[] = {NULL};
+  pid_t pid;
   /* Return first part of HTTP response */
   sprintf(buf, "HTTP/1.0 200 OK\r\n");
-  Rio_writen(fd, buf, strlen(buf));
-  sprintf(buf, "Server: Tiny Web Server\r\n");
-  Rio_writen(fd, buf, strlen(buf));
-  if (Fork() == 0)
+  sprintf(buf + strlen(buf), "Server: Tiny Web Server\r\n");
+  sprintf(buf + strlen(buf), "Connection: close\r\n");
+  if (rio_writen(fd, buf, strlen(buf)) < 0)
+  { /* Client gone: don't bother running the program */
+    fprintf(stderr, "serve_dynamic: write error: %s\n", strerror(errno));
+    return;
+  }
+  if ((pid = Fork()) == 0)
   { /* Child */
     /* Real server would set all CGI vars here */
     setenv("QUERY_STRING", cgiargs, 1);
     Dup2(fd, STDOUT_FILENO);              /* Redirect stdout to client */
     Execve(filename, emptylist, environ); /* Run CGI program */
   }
-  Wait(NULL); /* Parent waits for and reaps child */
+  Waitpid(pid, NULL, 0); /* Parent waits for and reaps its own child */
+}
+
+/*
+ * send_cgi - send the output of an in-process or pooled CGI program
+ *     (header lines, blank line, body) behind tiny's own status line
+ */
+ssize_t send_cgi(int fd, char *out, size_t n)
+{
+  char hdr[] = "HTTP/1.0 200 OK\r\n"
+               "Server: Tiny Web Server\r\n"
+               "Connection: close\r\n";
+  struct iovec iov[2] = {{hdr, strlen(hdr)}, {out, n}};
+
+  return send_vec(fd, iov, 2, 0);
+}
+
+/* reload_thread - rebuild the in-memory tree on every SIGHUP */
+void *reload_thread(void *vargp)
+{
+  sigset_t mask;
+  int sig;
+
+  Pthread_detach(pthread_self());
+  Sigemptyset(&mask);
+  Sigaddset(&mask, SIGHUP);
+  while (1)
+    if (sigwait(&mask, &sig) == 0)
+      memfs_load(".");
+  return NULL;
+}
+
+/* worker - serve connections handed over by main until the process exits */
+void *worker(void *vargp)
+{
+  Pthread_detach(pthread_self());
+  while (1)
+  {
+    int connfd = sbuf_remove(&sbuf);
+    doit(connfd);
+    Close(connfd);
+  }
+  return NULL;
 }
 
 int main(int argc, char **argv)
 {
-  int listenfd, connfd;
+  int listenfd, connfd, opt, inmem = 0, nthreads = 0, ncgi = 0;
   char hostname[MAXLINE], port[MAXLINE];
   socklen_t clientlen;
   struct sockaddr_storage clientaddr;
+  sigset_t mask;
+  pthread_t tid;
 
-  /* Check command line args */
-  if (argc != 2)
+  /* Check command line args: -m serves the whole tree from memory,
+     -t N serves connections from N prethreaded workers,
+     -c N keeps N persistent workers per loop-mode CGI program */
+  while ((opt = getopt(argc, argv, "mt:c:")) != -1)
+  {
+    if (opt == 'm')
+      inmem = 1;
+    else if (opt == 't' && (nthreads = atoi(optarg)) > 0 && nthreads <= NTHREADS_MAX)
+      continue;
+    else if (opt == 'c' && (ncgi = atoi(optarg)) > 0 && ncgi <= NTHREADS_MAX)
+      continue;
+    else
+      break;
+  }
+  if (opt != -1 || optind != argc - 1)
   {
-    fprintf(stderr, "usage: %s <port>\n", argv[0]);
+    fprintf(stderr, "usage: %s [-m] [-t nthreads] [-c cgiworkers] <port>\n", argv[0]);
     exit(1);
   }
+  cgipool_init(ncgi);
+  handler_load("./cgi-bin");
+  /* A client that hangs up mid-response must not kill the server */
+  Signal(SIGPIPE, SIG_IGN);
+
+  if (inmem)
+  { /* SIGHUP is taken by reload_thread only */
+    Sigemptyset(&mask);
+    Sigaddset(&mask, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+    memfs_load(".");
+    Pthread_create(&tid, NULL, reload_thread, NULL);
+  }
 
-  listenfd = Open_listenfd(argv[1]);
+  if (nthreads)
+  {
+    keepalive = 1;
+    sbuf_init(&sbuf, SBUFSIZE);
+    for (int i = 0; i < nthreads; i++)
+      Pthread_create(&tid, NULL, worker, NULL);
+  }
+
+  listenfd = Open_listenfd(argv[optind]);
   while (1)
   {
     clientlen = sizeof(clientaddr);
@@ -208,7 +712,12 @@ int main(int argc, char **argv)
     Getnameinfo((SA *)&clientaddr, clientlen, hostname, MAXLINE, port, MAXLINE,
                 0);
     printf("Accepted connection from (%s, %s)\n", hostname, port);
+    if (nthreads)
+    {
+      sbuf_insert(&sbuf, connfd);
+      continue;
+    }
     doit(connfd);  // line:netp:tiny:doit
     Close(connfd); // line:netp:tiny:close
   }
-}
\ No newline at end of file
+}
\ No newline at end of file